@@ -0,0 +1,6 @@
+#include "DataAccess.h"
+
+//The storage task (SD card, SQLite) is not part of the host build, settings are only kept in memory
+bool DataAccess::updateSystemSettings(SystemSettings* settings) {
+  return true;
+}
@@ -0,0 +1,29 @@
+#include "HostPlant.h"
+
+DataAccess dataAccess;
+MachineController machineController;
+MotorSupervisor motorSupervisor;
+SystemSettings hostSystemSettings = {};
+SystemSettings* systemSettings = &hostSystemSettings;
+UserSettings hostUserSettings = {};
+Snapshot<UserSettings> userSettingsSnapshot;
+
+void runMotorSupervisor() {
+  motorSupervisor.step();
+}
+
+void initHostPlant(double containerMass, double plateMass) {
+  hostReset();
+  hostSystemSettings.ContainerAngleClose = 0;
+  hostSystemSettings.ContainerAngleOpen = 90;
+  hostSystemSettings.ContainerScale = SIM_COUNTS_PER_GRAMM;
+  hostSystemSettings.PlateScale = SIM_COUNTS_PER_GRAMM;
+  userSettingsSnapshot.publish(&hostUserSettings);
+
+  resetSimulatedPlant(containerMass, plateMass);
+  machineController.initControls();
+  machineController.setContainerScaleCalibration(SIM_COUNTS_PER_GRAMM, SIM_ZERO_OFFSET, 0);
+  machineController.setPlateScaleCalibration(SIM_COUNTS_PER_GRAMM, SIM_ZERO_OFFSET, 0);
+  motorSupervisor.init();
+  hostEvery(MOTOR_TICK_INTERVAL, runMotorSupervisor);
+}
@@ -0,0 +1,18 @@
+#ifndef HOSTPLANT_H
+#define HOSTPLANT_H
+
+#include "HostRuntime.h"
+#include "MachineController.h"
+#include "MotorSupervisor.h"
+#include "Simulation.h"
+
+//Globals the firmware defines in the sketch, set up for the simulated feeder: calibrated scales,
+//servo closed at 0 degree and open at 90 degree, moved by the motor supervisor every MOTOR_TICK_INTERVAL.
+
+extern MachineController machineController;
+extern MotorSupervisor motorSupervisor;
+extern SystemSettings hostSystemSettings;
+
+void initHostPlant(double containerMass, double plateMass);
+
+#endif
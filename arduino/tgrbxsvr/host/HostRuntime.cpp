@@ -0,0 +1,222 @@
+#include "HostRuntime.h"
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <freertos/queue.h>
+#include <freertos/event_groups.h>
+#include <deque>
+#include <vector>
+
+HostSerial Serial;
+
+struct HostPeriodic {
+  HostCallback Callback;
+  int64_t Period;  //µs
+  int64_t Next;
+};
+
+int64_t hostTime = 1000000;
+HostPeriodic periodics[HOST_MAX_PERIODIC];
+int periodicCount = 0;
+bool runningPeriodics = false;
+
+void hostReset(int64_t startMicros) {
+  hostTime = startMicros;
+  periodicCount = 0;
+}
+
+int64_t hostMicros() {
+  return hostTime;
+}
+
+void hostAdvance(int64_t micros) {
+  const int64_t end = hostTime + micros;
+  //a callback that waits itself only moves the time, it does not run the others recursively
+  if (runningPeriodics) {
+    hostTime = end;
+    return;
+  }
+
+  runningPeriodics = true;
+  while (true) {
+    int due = -1;
+    for (int i = 0; i < periodicCount; i++) {
+      if (periodics[i].Next <= end && (due < 0 || periodics[i].Next < periodics[due].Next)) {
+        due = i;
+      }
+    }
+    if (due < 0) {
+      break;
+    }
+    if (periodics[due].Next > hostTime) {
+      hostTime = periodics[due].Next;
+    }
+    periodics[due].Next += periodics[due].Period;
+    periodics[due].Callback();
+  }
+  runningPeriodics = false;
+  if (end > hostTime) {
+    hostTime = end;
+  }
+}
+
+bool hostEvery(unsigned long periodMS, HostCallback callback) {
+  if (periodicCount >= HOST_MAX_PERIODIC) {
+    return false;
+  }
+  periodics[periodicCount].Callback = callback;
+  periodics[periodicCount].Period = (int64_t)periodMS * 1000;
+  periodics[periodicCount].Next = hostTime + periodics[periodicCount].Period;
+  periodicCount++;
+  return true;
+}
+
+//--- Arduino ---
+
+unsigned long millis() {
+  return hostTime / 1000;
+}
+
+unsigned long micros() {
+  return hostTime;
+}
+
+void delay(unsigned long ms) {
+  hostAdvance((int64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  hostAdvance(us);
+}
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t, uint8_t) {}
+
+int digitalRead(uint8_t) {
+  return LOW;
+}
+
+int64_t esp_timer_get_time() {
+  return hostTime;
+}
+
+//--- FreeRTOS, single task ---
+
+int dummyHandle = 0;
+EventBits_t eventBits = 0;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char*, uint32_t, void*, UBaseType_t, TaskHandle_t* handle, BaseType_t) {
+  if (handle != nullptr) {
+    *handle = &dummyHandle;
+  }
+  return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t) {}
+
+void vTaskDelay(TickType_t ticks) {
+  hostAdvance((int64_t)ticks * portTICK_PERIOD_MS * 1000);
+}
+
+TickType_t xTaskGetTickCount() {
+  return hostTime / 1000 / portTICK_PERIOD_MS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  return &dummyHandle;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t, TickType_t) {
+  return 0;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t) {
+  return pdPASS;
+}
+
+struct HostQueue {
+  UBaseType_t Length;
+  UBaseType_t ItemSize;
+  std::deque<std::vector<uint8_t>> Items;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  return new HostQueue{ length, itemSize, {} };
+}
+
+BaseType_t xQueueSend(QueueHandle_t handle, const void* item, TickType_t) {
+  HostQueue* queue = (HostQueue*)handle;
+  if (queue->Items.size() >= queue->Length) {
+    return pdFALSE;
+  }
+  const uint8_t* bytes = (const uint8_t*)item;
+  queue->Items.push_back(std::vector<uint8_t>(bytes, bytes + queue->ItemSize));
+  return pdTRUE;
+}
+
+//never waits, the harness runs the work of the receiving task periodically (see hostEvery)
+BaseType_t xQueueReceive(QueueHandle_t handle, void* item, TickType_t) {
+  HostQueue* queue = (HostQueue*)handle;
+  if (queue->Items.empty()) {
+    return pdFALSE;
+  }
+  memcpy(item, queue->Items.front().data(), queue->ItemSize);
+  queue->Items.pop_front();
+  return pdTRUE;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  return &dummyHandle;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+  return &dummyHandle;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t, UBaseType_t) {
+  return &dummyHandle;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t) {
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t) {
+  return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t) {}
+
+EventGroupHandle_t xEventGroupCreate() {
+  return &eventBits;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+  return *(EventBits_t*)group |= bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+  const EventBits_t previous = *(EventBits_t*)group;
+  *(EventBits_t*)group &= ~bits;
+  return previous;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+  return *(EventBits_t*)group;
+}
+
+//nothing else sets bits while the only task waits, so a wait without the bits set just lets the time pass
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clearOnExit, BaseType_t waitForAll, TickType_t ticks) {
+  EventBits_t& value = *(EventBits_t*)group;
+  const bool satisfied = waitForAll ? (value & bits) == bits : (value & bits) != 0;
+  if (!satisfied && ticks != portMAX_DELAY) {
+    vTaskDelay(ticks);
+  }
+  const EventBits_t result = value;
+  if (satisfied && clearOnExit) {
+    value &= ~bits;
+  }
+  return result;
+}
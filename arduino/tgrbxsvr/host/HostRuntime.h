@@ -0,0 +1,19 @@
+#ifndef HOSTRUNTIME_H
+#define HOSTRUNTIME_H
+
+#include <stdint.h>
+
+//Virtual time of the host build. millis(), micros(), delay(), vTaskDelay() and esp_timer_get_time() use it,
+//nothing waits for real. Periodic callbacks stand in for the background tasks of the firmware (e.g. the motor
+//supervisor moving the servo), they run whenever the virtual time passes their next due time.
+
+typedef void (*HostCallback)();
+
+const int HOST_MAX_PERIODIC = 8;
+
+void hostReset(int64_t startMicros = 1000000);
+int64_t hostMicros();
+void hostAdvance(int64_t micros);  //runs the periodic callbacks due meanwhile
+bool hostEvery(unsigned long periodMS, HostCallback callback);
+
+#endif
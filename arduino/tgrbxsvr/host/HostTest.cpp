@@ -0,0 +1,8 @@
+#include "HostTest.h"
+
+int hostTestFailures = 0;
+
+int hostTestResult() {
+  printf(hostTestFailures == 0 ? "PASS\n" : "FAIL (%d)\n", hostTestFailures);
+  return hostTestFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,30 @@
+#ifndef HOSTTEST_H
+#define HOSTTEST_H
+
+#include <stdio.h>
+
+//Minimal checks for the host tests, a test program returns hostTestResult() from main
+
+extern int hostTestFailures;
+
+#define CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+      hostTestFailures++; \
+    } \
+  } while (0)
+
+#define CHECK_NEAR(value, expected, tolerance) \
+  do { \
+    const double checkValue = (value); \
+    if (checkValue < (expected) - (tolerance) || checkValue > (expected) + (tolerance)) { \
+      printf("%s:%d: CHECK_NEAR failed: %s = %g, expected %g +- %g\n", __FILE__, __LINE__, #value, checkValue, \
+             (double)(expected), (double)(tolerance)); \
+      hostTestFailures++; \
+    } \
+  } while (0)
+
+int hostTestResult();
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+//Host shim of the Arduino core, just enough for the control modules. Time is virtual (see HostRuntime.h).
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+#include <iostream>
+
+using std::abs;
+using std::max;
+using std::min;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define PI 3.1415926535897932384626433832795
+
+class String {
+public:
+  String() {}
+  String(const char* value)
+    : value(value != nullptr ? value : "") {}
+  String(const std::string& value)
+    : value(value) {}
+  String(int value)
+    : value(std::to_string(value)) {}
+  String(long value)
+    : value(std::to_string(value)) {}
+  String(double value)
+    : value(std::to_string(value)) {}
+
+  const char* c_str() const {
+    return value.c_str();
+  }
+  size_t length() const {
+    return value.size();
+  }
+  bool equals(const String& other) const {
+    return value == other.value;
+  }
+  bool operator==(const String& other) const {
+    return value == other.value;
+  }
+  String operator+(const String& other) const {
+    return String(value + other.value);
+  }
+  String& operator+=(const String& other) {
+    value += other.value;
+    return *this;
+  }
+  long toInt() const {
+    return atol(value.c_str());
+  }
+
+private:
+  std::string value;
+};
+
+inline std::ostream& operator<<(std::ostream& stream, const String& value) {
+  return stream << value.c_str();
+}
+
+class HostSerial {
+public:
+  void begin(unsigned long) {}
+  template<typename T>
+  void print(const T& value) {
+    std::cout << value;
+  }
+  template<typename T>
+  void println(const T& value) {
+    std::cout << value << std::endl;
+  }
+  void println() {
+    std::cout << std::endl;
+  }
+  template<typename... Args>
+  void printf(const char* format, Args... args) {
+    ::printf(format, args...);
+  }
+};
+
+extern HostSerial Serial;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef FREERTOS_PROJDEFS_H
+#define FREERTOS_PROJDEFS_H
+
+#include "FreeRTOS.h"
+
+#endif
@@ -0,0 +1,140 @@
+#include "HostPlant.h"
+#include "SlopeEstimator.h"
+#include "FeedController.h"
+#include "LoopGovernor.h"
+#include <stdio.h>
+
+//Runs continuous feeds against the simulated plant with the feed code of the firmware: the FeedController opens
+//the container through the motor supervisor, the flow controller throttles it, the feed model closes it at the
+//predicted instant and learns the close latency from the settled result. The harness only plays the control loop
+//around it: one sample per loop at the fast loop rate and the status the loop builds from it.
+//Usage: simulate_feed [requested gramm] [feeds]. The first LEARNING_FEEDS learn the close latency, the feeds after
+//them fail the run if their mean overshoot exceeds MAX_MEAN_ERROR or its standard deviation exceeds MAX_SPREAD.
+
+const double LOOP_PERIOD = 1 / LOOP_TIERS[FastTier].Frequency;  //seconds, the loop rate while feeding
+const int LEARNING_FEEDS = 5;
+const double MAX_MEAN_ERROR = 1;  //gramm
+const double MAX_SPREAD = 1;      //gramm, standard deviation
+const double MAX_FEED_TIME = 60;  //seconds
+
+SlopeEstimator containerSlope;
+SlopeEstimator plateSlope;
+FeedController feedController;
+MachineStatus status = {};
+
+//outcome of the running feed, set by the callbacks of the FeedController
+bool feedFinished = false;
+bool feedFailed = false;
+bool hasResult = false;
+FeedResult feedResult;
+
+void onFeedFinished() {
+  feedFinished = true;
+}
+
+void onFeedAborted() {
+  feedFailed = true;
+}
+
+void onMotorFailure() {
+  feedFailed = true;
+}
+
+void onFeedResult(const FeedResult& result) {
+  feedResult = result;
+  hasResult = true;
+}
+
+//like updateStatus() of the sketch, every loop handles a new sample
+void updateStatus(int64_t timestamp) {
+  machineController.sample();
+  const ScaleSample sample = machineController.getLatestSample();
+  status.ContainerLoad = sample.ContainerLoad;
+  status.PlateLoad = sample.PlateLoad;
+  status.SampleRate = sample.SampleRate;
+  containerSlope.add(timestamp, status.ContainerLoad);
+  plateSlope.add(timestamp, status.PlateLoad);
+  status.ContainerFlowRate = containerSlope.getSlope();
+  status.PlateFlowRate = plateSlope.getSlope();
+  status.ContainerOpening = machineController.getContainerOpening();
+  status.MotorOperation = motorSupervisor.getMotorOperation();
+  motorSupervisor.updateLoad(status.ContainerLoad, status.ContainerFlowRate);
+}
+
+void waitUntil(unsigned long start, double period) {
+  const unsigned long end = start + period * 1000;
+  if (millis() < end) {
+    delay(end - millis());
+  }
+}
+
+bool runFeed(double requested, FeedResult& result) {
+  for (int i = 0; i < 4; i++) {
+    updateStatus(millis());
+  }
+
+  feedFinished = false;
+  feedFailed = false;
+  hasResult = false;
+  const unsigned long feedStart = millis();
+  feedController.start(status, millis(), status.ContainerLoad - requested, ContinuousDispense);
+  double feedTime = 0;
+
+  //the next feed only starts from Idle, the close check may still run after the result
+  while (!hasResult || feedController.getState() != FeedIdle) {
+    const unsigned long start = millis();
+    updateStatus(start);
+    if (feedController.getState() != FeedIdle) {
+      feedController.update(status, start, LOOP_PERIOD);
+    }
+    feedController.updateMeasurement(status, start);
+
+    if (feedFinished && feedTime == 0) {
+      feedTime = (millis() - feedStart) / 1000.0;
+    }
+    if (feedFailed || millis() - feedStart > MAX_FEED_TIME * 1000) {
+      return false;
+    }
+    waitUntil(start, LOOP_PERIOD);
+  }
+  result = feedResult;
+
+  printf("requested %6.1f g  dispensed %6.1f g  overshoot %+5.1f g  close flow %5.1f g/s  latency %.3f s  time %5.2f s  plate %6.1f g\n",
+         result.Requested, result.Dispensed, result.Overshoot, result.FlowRate, result.CloseLatency, feedTime, simulatedPlant.PlateMass);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  const double requested = argc > 1 ? atof(argv[1]) : 40;
+  const int feeds = argc > 2 ? atoi(argv[2]) : 20;
+
+  initHostPlant(1000, 0);
+  feedController.init(DEFAULT_CLOSE_LATENCY);
+
+  double sum = 0;
+  double sumSquares = 0;
+  int counted = 0;
+  for (int i = 0; i < feeds; i++) {
+    FeedResult result;
+    if (!runFeed(requested, result)) {
+      printf("feed %d did not finish\n", i + 1);
+      return 1;
+    }
+    if (i >= LEARNING_FEEDS) {
+      sum += result.Overshoot;
+      sumSquares += result.Overshoot * result.Overshoot;
+      counted++;
+    }
+  }
+  if (counted < 2) {
+    printf("needs more than %d feeds\n", LEARNING_FEEDS + 1);
+    return 1;
+  }
+
+  const double mean = sum / counted;
+  const double spread = sqrt(max(sumSquares / counted - mean * mean, 0.0));
+  const bool success = fabs(mean) <= MAX_MEAN_ERROR && spread <= MAX_SPREAD;
+  printf("overshoot after learning: mean %+.2f g  spread %.2f g\n", mean, spread);
+  printf(success ? "PASS\n" : "FAIL\n");
+  return success ? 0 : 1;
+}
@@ -0,0 +1,203 @@
+#include "CalendarSchedule.h"
+#include "FeedTimeTable.h"
+#include "HostTest.h"
+#include <vector>
+#include <string>
+#include <algorithm>
+
+//Walks CalendarSchedule through years of virtual days, fire by fire, and compares every lookup with a plain
+//evaluation of the rules: weekday rules with and without date ranges, exceptions, long feedless stretches.
+
+const long FIRST_DAY = 19700;  //2023-12-08
+const long SIMULATED_DAYS = 4 * 366;
+const long MS_PER_MINUTE = 60000L;
+
+struct TestRule {
+  int Weekdays;
+  long FirstDay;  //relative to FIRST_DAY, -1 = open
+  long LastDay;
+  std::vector<long> Minutes;
+};
+
+struct TestException {
+  long Day;  //relative to FIRST_DAY
+  std::vector<long> Minutes;
+};
+
+std::vector<TestRule> rules;
+std::vector<TestException> exceptions;
+
+std::string toRuleString() {
+  std::string text;
+  char buffer[64];
+  for (const TestRule& rule : rules) {
+    snprintf(buffer, sizeof(buffer), "%x/%ld-%ld/", rule.Weekdays, rule.FirstDay < 0 ? 0 : FIRST_DAY + rule.FirstDay,
+             rule.LastDay < 0 ? 0 : FIRST_DAY + rule.LastDay);
+    text += buffer;
+    for (size_t i = 0; i < rule.Minutes.size(); i++) {
+      text += (i > 0 ? "," : "") + std::to_string(rule.Minutes[i]);
+    }
+    text += ";";
+  }
+  for (const TestException& exception : exceptions) {
+    text += "!" + std::to_string(FIRST_DAY + exception.Day) + "/";
+    for (size_t i = 0; i < exception.Minutes.size(); i++) {
+      text += (i > 0 ? "," : "") + std::to_string(exception.Minutes[i]);
+    }
+    text += ";";
+  }
+  return text;
+}
+
+//sorted daytimes in ms of an absolute day, straight from the rules
+std::vector<long> referenceDaytimes(long day) {
+  std::vector<long> daytimes;
+  const TestException* exception = nullptr;
+  for (const TestException& candidate : exceptions) {
+    if (FIRST_DAY + candidate.Day == day) {
+      exception = &candidate;
+    }
+  }
+  if (exception != nullptr) {
+    for (long minute : exception->Minutes) {
+      daytimes.push_back(minute * MS_PER_MINUTE);
+    }
+  } else {
+    for (const TestRule& rule : rules) {
+      const bool inRange = (rule.FirstDay < 0 || day >= FIRST_DAY + rule.FirstDay) && (rule.LastDay < 0 || day <= FIRST_DAY + rule.LastDay);
+      if (inRange && (rule.Weekdays & (1 << CalendarSchedule::getWeekday(day)))) {
+        for (long minute : rule.Minutes) {
+          daytimes.push_back(minute * MS_PER_MINUTE);
+        }
+      }
+    }
+  }
+  std::sort(daytimes.begin(), daytimes.end());
+  daytimes.erase(std::unique(daytimes.begin(), daytimes.end()), daytimes.end());
+  return daytimes;
+}
+
+//checks every day and fires the schedule from fire to fire like the feeder does, returns the number of fires
+int walk(const CalendarSchedule& schedule) {
+  int fires = 0;
+  long day = FIRST_DAY;
+  long daytime = -1;
+  const long lastDay = FIRST_DAY + SIMULATED_DAYS;
+
+  while (day <= lastDay) {
+    //the expected next fire by probing day by day
+    long expectedDay = day;
+    long expectedDaytime = -1;
+    for (; expectedDay <= lastDay + 400 && expectedDaytime < 0; expectedDay++) {
+      for (long candidate : referenceDaytimes(expectedDay)) {
+        if (expectedDay > day || candidate > daytime) {
+          expectedDaytime = candidate;
+          break;
+        }
+      }
+    }
+    expectedDay--;
+
+    long fireDay;
+    long fireDaytime;
+    const bool found = schedule.getNextFire(day, daytime, fireDay, fireDaytime);
+    if (expectedDaytime < 0) {
+      CHECK(!found);
+      return fires;
+    }
+    CHECK(found);
+    if (!found || fireDay != expectedDay || fireDaytime != expectedDaytime) {
+      printf("day %ld daytime %ld: fire %ld/%ld, expected %ld/%ld\n", day, daytime, fireDay, fireDaytime, expectedDay, expectedDaytime);
+      hostTestFailures++;
+      return fires;
+    }
+
+    //all days up to the fire keep their tables
+    for (long checkDay = day; checkDay <= fireDay; checkDay++) {
+      std::vector<long> daytimes;
+      schedule.getDaytimes(checkDay, daytimes);
+      CHECK(daytimes == referenceDaytimes(checkDay));
+    }
+
+    if (fireDay > lastDay) {
+      break;
+    }
+    day = fireDay;
+    daytime = fireDaytime;
+    fires++;
+  }
+  return fires;
+}
+
+void testWeekdaysWithExceptions() {
+  rules = { { 0x1f, -1, -1, { 420, 1080 } }, { 0x60, -1, -1, { 540, 1140 } } };
+  exceptions = { { 3, {} }, { 10, { 600 } }, { 11, { 1439 } }, { 400, {} } };
+
+  CalendarSchedule schedule;
+  CHECK(schedule.compile(toRuleString().c_str()));
+  //two feeds a day, except the day without a feed and the single feed days
+  CHECK(walk(schedule) == 2 * (SIMULATED_DAYS + 1) - 6);
+}
+
+void testDateRanges() {
+  //overlapping holiday ranges on top of a weekday rule that ends after two years
+  rules = { { 0x7f, -1, 2 * 365, { 480 } }, { 0x7f, 100, 120, { 720, 480 } }, { 0x15, 110, 500, { 1000 } } };
+  exceptions = { { 115, { 0 } }, { 730, { 60 } } };
+
+  CalendarSchedule schedule;
+  CHECK(schedule.compile(toRuleString().c_str()));
+  walk(schedule);
+}
+
+void testFeedlessStretches() {
+  //a feed on a few separated days only, months without a feed in between
+  rules = { { 0x01, 200, 206, { 300 } }, { 0x7f, 900, 900, { 10 } } };
+  exceptions = { { 50, { 100 } }, { 1200, { 200 } }, { 1300, {} } };
+
+  CalendarSchedule schedule;
+  CHECK(schedule.compile(toRuleString().c_str()));
+  CHECK(walk(schedule) == 4);
+
+  //nothing after the last exception
+  long fireDay;
+  long fireDaytime;
+  CHECK(!schedule.getNextFire(FIRST_DAY + 1200, 200 * MS_PER_MINUTE, fireDay, fireDaytime));
+}
+
+void testInvalidRules() {
+  CalendarSchedule schedule;
+  CHECK(!schedule.compile("1f/0-0/1440;"));
+  CHECK(!schedule.compile("1f/0/420"));
+  CHECK(!schedule.compile("!19700420"));
+  //the schedule is empty afterwards
+  long fireDay;
+  long fireDaytime;
+  CHECK(!schedule.getNextFire(FIRST_DAY, -1, fireDay, fireDaytime));
+  CHECK(schedule.compile(nullptr));
+  CHECK(!schedule.getNextFire(FIRST_DAY, -1, fireDay, fireDaytime));
+}
+
+void testFeedTimeTable() {
+  FeedTimeTable table;
+  table.compile({ 1080 * MS_PER_MINUTE, 420 * MS_PER_MINUTE, -5, MS_PER_DAY }, 420 * MS_PER_MINUTE);
+  CHECK(table.getCount() == 2);
+  CHECK(table.getFirstDaytime() == 420 * MS_PER_MINUTE);
+  CHECK(table.getNextDaytime() == 1080 * MS_PER_MINUTE);
+  CHECK(!table.isDue(1079 * MS_PER_MINUTE));
+  CHECK(table.isDue(1081 * MS_PER_MINUTE));
+  table.advance(1081 * MS_PER_MINUTE);
+  CHECK(table.getNextDaytime() == -1);
+  table.newDay();
+  CHECK(table.getNextDaytime() == 420 * MS_PER_MINUTE);
+  table.clear();
+  CHECK(table.getFirstDaytime() == -1);
+}
+
+int main() {
+  testWeekdaysWithExceptions();
+  testDateRanges();
+  testFeedlessStretches();
+  testInvalidRules();
+  testFeedTimeTable();
+  return hostTestResult();
+}
@@ -0,0 +1,40 @@
+#include "HostPlant.h"
+#include "HostTest.h"
+
+//The dispensing phase switches both simulated HX711 to 80 SPS, idle and measuring stay at 10 SPS
+
+const int SAMPLES = 20;
+
+//conversions per second over SAMPLES samples in the given phase, both load cells are read one after another
+double measureConversionRate(FeederPhase phase, double& sampleRate) {
+  machineController.setSamplingPhase(phase);
+  machineController.sample();  //applies the phase
+
+  const unsigned long conversions = simulatedPlant.Conversions;
+  const unsigned long start = millis();
+  for (int i = 0; i < SAMPLES; i++) {
+    machineController.sample();
+  }
+  sampleRate = machineController.getSampleRate();
+  return (simulatedPlant.Conversions - conversions) / ((millis() - start) / 1000.0);
+}
+
+int main() {
+  initHostPlant(500, 0);
+
+  double idleRate;
+  CHECK_NEAR(measureConversionRate(IdlePhase, idleRate), 10, 0.2);
+
+  double dispensingRate;
+  CHECK_NEAR(measureConversionRate(DispensingPhase, dispensingRate), 80, 1);
+  //fewer samples per reading at the high rate, the filtered readings come much faster
+  CHECK(dispensingRate >= 10 * idleRate);
+
+  double measuringRate;
+  CHECK_NEAR(measureConversionRate(MeasuringPhase, measuringRate), 10, 0.2);
+
+  CHECK_NEAR(measureConversionRate(DispensingPhase, dispensingRate), 80, 1);
+  CHECK_NEAR(measureConversionRate(IdlePhase, idleRate), 10, 0.2);
+
+  return hostTestResult();
+}
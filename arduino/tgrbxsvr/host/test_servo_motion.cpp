@@ -0,0 +1,73 @@
+#include "HostPlant.h"
+#include "HostTest.h"
+
+//The flap keeps its velocity when the target moves, retargeting with every loop does not slow the opening down.
+//A pulse opens the flap at full servo speed within getPulseOpenTime()
+//The servo is detached once it rests closed, so light sleep does not cut its holding pulse
+
+const unsigned long LOOP_PERIOD = 20;  //ms, the fast loop rate of the firmware
+
+//ms until the commanded angle reaches the angle, calling retarget every LOOP_PERIOD
+unsigned long timeToAngle(double angle, void (*retarget)()) {
+  const unsigned long start = millis();
+  while (fabs(simulatedPlant.CommandedAngle - angle) > 0.5 && millis() - start < 10000) {
+    if (retarget != nullptr) {
+      retarget();
+    }
+    delay(LOOP_PERIOD);
+  }
+  return millis() - start;
+}
+
+void openFully() {
+  machineController.setContainerOpening(1);
+}
+
+//the flow controller raising the opening a bit with every loop
+void rampOpening() {
+  machineController.setContainerOpening(machineController.getContainerOpening() + 0.05);
+}
+
+void close() {
+  machineController.closeContainer();
+  timeToAngle(0, nullptr);
+}
+
+int main() {
+  initHostPlant(500, 0);
+
+  //a single move to 90 degree at 180 degree/second with a 0.1 s ramp takes 0.6 s
+  machineController.openContainer();
+  const unsigned long single = timeToAngle(90, nullptr);
+  CHECK_NEAR(single, 600, 40);
+  close();
+
+  CHECK(timeToAngle(90, openFully) <= single + LOOP_PERIOD);
+  close();
+
+  CHECK(timeToAngle(90, rampOpening) <= 1000);
+  close();
+
+  machineController.pulseOpenContainer();
+  CHECK(timeToAngle(90, nullptr) <= machineController.getPulseOpenTime() * 1000 + LOOP_PERIOD);
+  CHECK(machineController.getPulseOpenTime() <= 0.3);
+  close();
+
+  //closing at 360 degree/second with the same ramp
+  machineController.openContainer();
+  timeToAngle(90, nullptr);
+  machineController.closeContainer();
+  CHECK_NEAR(timeToAngle(0, nullptr), 350, 40);
+
+  CHECK(machineController.isServoAttached());
+  delay(600);  //past the 500 ms detach delay
+  CHECK(!machineController.isServoAttached());
+  machineController.openContainer();
+  delay(LOOP_PERIOD);
+  CHECK(machineController.isServoAttached());
+  CHECK(timeToAngle(90, nullptr) <= single + LOOP_PERIOD);
+  delay(600);  //past the 500 ms detach delay
+  CHECK(machineController.isServoAttached());  //held open
+
+  return hostTestResult();
+}
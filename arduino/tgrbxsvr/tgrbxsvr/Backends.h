@@ -0,0 +1,150 @@
+#ifndef BACKENDS_H
+#define BACKENDS_H
+
+#include "Models.h"
+
+//Scale and actuator backends used by the MachineController.
+//The backend is chosen at compile time (no virtual calls), every backend has to provide the same methods:
+//
+//  Scale:    begin(doutPin, sckPin, ratePin), isReady(), getValue(samples) (raw minus offset), tare(samples),
+//            setScale(factor), getScale(), setOffset(offset), getOffset(), setRate(rate), getRate()
+//  Actuator: attach(pin), write(angle)
+//
+//Build with SIMULATED_PLANT defined to run the control code against the simulated feeder in Simulation.h.
+
+#ifdef SIMULATED_PLANT
+
+#include "Simulation.h"
+
+typedef SimulatedScale ScaleBackend;
+typedef SimulatedActuator ActuatorBackend;
+
+#else
+
+#include <HX711.h>
+#include <Servo.h>
+
+//conversions after a RATE change until the HX711 output is settled again
+const int HX711_SETTLING_CONVERSIONS = 4;
+//ms, a conversion at 10 SPS. The GPIO interrupt does not wake the CPU from light sleep,
+//so the ready state is checked once per conversion while the CPU sleeps
+const int HX711_READY_TIMEOUT = 100;
+
+//The HX711 library polls DOUT until a conversion is ready, which keeps a task of higher priority running for
+//the whole conversion. The reading task blocks on the falling edge of DOUT instead, so the lower priority tasks
+//run and the CPU may sleep in between.
+class HX711Scale {
+public:
+  HX711Scale(Scale id)
+    : doutPin(-1), ratePin(-1), rate(LowRate), settling(0), ready(nullptr) {}
+
+  //ratePin = -1 if the RATE pin of the module is hard wired
+  inline bool begin(int doutPin, int sckPin, int ratePin) {
+    this->ratePin = ratePin;
+    if (ratePin >= 0) {
+      pinMode(ratePin, OUTPUT);
+      digitalWrite(ratePin, LOW);
+    }
+    this->doutPin = doutPin;
+    hx711.begin(doutPin, sckPin);
+    ready = xSemaphoreCreateBinary();
+    return ready != nullptr;
+  }
+  inline bool isReady() {
+    return hx711.is_ready();
+  }
+  inline double getValue(int samples) {
+    for (; settling > 0; settling--) {
+      read();
+    }
+    return readAverage(samples) - hx711.get_offset();
+  }
+  inline void tare(int samples) {
+    hx711.set_offset(readAverage(samples));
+  }
+  inline void setScale(double factor) {
+    hx711.set_scale(factor);
+  }
+  inline double getScale() {
+    return hx711.get_scale();
+  }
+  inline void setOffset(long offset) {
+    hx711.set_offset(offset);
+  }
+  inline long getOffset() {
+    return hx711.get_offset();
+  }
+  inline void setRate(ScaleRate newRate) {
+    if (ratePin < 0 || newRate == rate) {
+      return;
+    }
+    digitalWrite(ratePin, newRate == HighRate ? HIGH : LOW);
+    rate = newRate;
+    settling = HX711_SETTLING_CONVERSIONS;
+  }
+  inline ScaleRate getRate() {
+    return rate;
+  }
+
+private:
+  static void IRAM_ATTR onReady(void* arg) {
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(((HX711Scale*)arg)->ready, &woken);
+    if (woken == pdTRUE) {
+      portYIELD_FROM_ISR();
+    }
+  }
+
+  //the interrupt is only attached while waiting, DOUT also toggles while the value is shifted out
+  inline void waitReady() {
+    while (!hx711.is_ready()) {
+      xSemaphoreTake(ready, 0);
+      attachInterruptArg(doutPin, onReady, this, FALLING);
+      if (!hx711.is_ready()) {
+        xSemaphoreTake(ready, pdMS_TO_TICKS(HX711_READY_TIMEOUT));
+      }
+      detachInterrupt(doutPin);
+    }
+  }
+  inline long read() {
+    waitReady();
+    return hx711.read();
+  }
+  inline double readAverage(int samples) {
+    long sum = 0;
+    for (int i = 0; i < samples; i++) {
+      sum += read();
+    }
+    return (double)sum / samples;
+  }
+
+  HX711 hx711;
+  int doutPin;
+  int ratePin;
+  ScaleRate rate;
+  int settling;
+  SemaphoreHandle_t ready;  //given by the DOUT interrupt
+};
+
+class ServoActuator {
+public:
+  inline void attach(int pin) {
+    servo.attach(pin);
+  }
+  inline void write(int angle) {
+    servo.write(angle);
+  }
+  inline void detach() {
+    servo.detach();
+  }
+
+private:
+  Servo servo;
+};
+
+typedef HX711Scale ScaleBackend;
+typedef ServoActuator ActuatorBackend;
+
+#endif
+
+#endif
@@ -0,0 +1,238 @@
+#include "CalendarSchedule.h"
+#include <stdlib.h>
+#include <algorithm>
+
+const long MS_PER_MINUTE = 60000L;
+const long MINUTES_PER_DAY = 1440L;
+
+CalendarSchedule::CalendarSchedule() {
+  clear();
+}
+
+void CalendarSchedule::clear() {
+  segments.clear();
+  tables.clear();
+  exceptions.clear();
+  tables.push_back(std::vector<long>());
+  Segment segment = { 0, { 0, 0, 0, 0, 0, 0, 0 }, true };
+  segments.push_back(segment);
+}
+
+int CalendarSchedule::getWeekday(long day) {
+  //1970-01-01 was a Thursday
+  return ((day + 3) % 7 + 7) % 7;
+}
+
+//minutes separated by ',' until ';' or the end
+bool parseMinutes(const char*& pos, std::vector<long>& daytimes) {
+  while (*pos != '\0' && *pos != ';') {
+    char* end;
+    const long minute = strtol(pos, &end, 10);
+    if (end == pos || minute < 0 || minute >= MINUTES_PER_DAY) {
+      return false;
+    }
+    daytimes.push_back(minute * MS_PER_MINUTE);
+    pos = end;
+    if (*pos == ',') {
+      pos++;
+    }
+  }
+  std::sort(daytimes.begin(), daytimes.end());
+  daytimes.erase(std::unique(daytimes.begin(), daytimes.end()), daytimes.end());
+  return true;
+}
+
+bool CalendarSchedule::parse(const char* rules, std::vector<CalendarRule>& parsedRules) {
+  const char* pos = rules;
+  char* end;
+
+  while (*pos != '\0') {
+    if (*pos == ';') {
+      pos++;
+      continue;
+    }
+
+    if (*pos == '!') {
+      CalendarException exception;
+      exception.Day = strtol(pos + 1, &end, 10);
+      if (end == pos + 1 || *end != '/') {
+        return false;
+      }
+      pos = end + 1;
+      if (!parseMinutes(pos, exception.Daytimes)) {
+        return false;
+      }
+      exceptions.push_back(exception);
+      continue;
+    }
+
+    CalendarRule rule;
+    rule.Weekdays = strtol(pos, &end, 16) & 0x7f;
+    if (end == pos || *end != '/') {
+      return false;
+    }
+    pos = end + 1;
+    rule.FirstDay = strtol(pos, &end, 10);
+    if (end == pos || *end != '-') {
+      return false;
+    }
+    pos = end + 1;
+    rule.LastDay = strtol(pos, &end, 10);
+    if (end == pos || *end != '/') {
+      return false;
+    }
+    pos = end + 1;
+    if (!parseMinutes(pos, rule.Daytimes) || parsedRules.size() >= CALENDAR_MAX_RULES) {
+      return false;
+    }
+    parsedRules.push_back(rule);
+  }
+
+  return true;
+}
+
+//returns the index of an equal table, adds it if there is none
+int CalendarSchedule::addTable(std::vector<long>& daytimes) {
+  std::sort(daytimes.begin(), daytimes.end());
+  daytimes.erase(std::unique(daytimes.begin(), daytimes.end()), daytimes.end());
+  for (int i = 0; i < (int)tables.size(); i++) {
+    if (tables[i] == daytimes) {
+      return i;
+    }
+  }
+  tables.push_back(daytimes);
+  return tables.size() - 1;
+}
+
+bool CalendarSchedule::compile(const char* rules) {
+  clear();
+  if (rules == nullptr) {
+    return true;
+  }
+
+  std::vector<CalendarRule> parsedRules;
+  if (!parse(rules, parsedRules)) {
+    clear();
+    return false;
+  }
+
+  //a later exception for the same day wins
+  std::stable_sort(exceptions.begin(), exceptions.end(), [](const CalendarException& a, const CalendarException& b) {
+    return a.Day < b.Day;
+  });
+  for (int i = (int)exceptions.size() - 1; i > 0; i--) {
+    if (exceptions[i - 1].Day == exceptions[i].Day) {
+      exceptions.erase(exceptions.begin() + i - 1);
+    }
+  }
+
+  //the set of active rules only changes at the range boundaries
+  std::vector<long> boundaries;
+  boundaries.push_back(0);
+  for (const CalendarRule& rule : parsedRules) {
+    if (rule.FirstDay > 0) {
+      boundaries.push_back(rule.FirstDay);
+    }
+    if (rule.LastDay > 0) {
+      boundaries.push_back(rule.LastDay + 1);
+    }
+  }
+  std::sort(boundaries.begin(), boundaries.end());
+  boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+
+  segments.clear();
+  for (long firstDay : boundaries) {
+    Segment segment;
+    segment.FirstDay = firstDay;
+    segment.Empty = true;
+    for (int weekday = 0; weekday < 7; weekday++) {
+      std::vector<long> daytimes;
+      for (const CalendarRule& rule : parsedRules) {
+        const bool inRange = (rule.FirstDay <= 0 || firstDay >= rule.FirstDay) && (rule.LastDay <= 0 || firstDay <= rule.LastDay);
+        if (inRange && (rule.Weekdays & (1 << weekday))) {
+          daytimes.insert(daytimes.end(), rule.Daytimes.begin(), rule.Daytimes.end());
+        }
+      }
+      segment.Tables[weekday] = addTable(daytimes);
+      segment.Empty = segment.Empty && segment.Tables[weekday] == 0;
+    }
+    segments.push_back(segment);
+  }
+
+  return true;
+}
+
+int CalendarSchedule::findSegment(long day) const {
+  int low = 0;
+  int high = segments.size() - 1;
+  while (low < high) {
+    const int mid = (low + high + 1) / 2;
+    if (segments[mid].FirstDay <= day) {
+      low = mid;
+    } else {
+      high = mid - 1;
+    }
+  }
+  return low;
+}
+
+const CalendarException* CalendarSchedule::findException(long day) const {
+  auto it = std::lower_bound(exceptions.begin(), exceptions.end(), day, [](const CalendarException& exception, long value) {
+    return exception.Day < value;
+  });
+  return it != exceptions.end() && it->Day == day ? &*it : nullptr;
+}
+
+const std::vector<long>& CalendarSchedule::getTable(long day) const {
+  const CalendarException* exception = findException(day);
+  if (exception != nullptr) {
+    return exception->Daytimes;
+  }
+  return tables[segments[findSegment(day)].Tables[getWeekday(day)]];
+}
+
+void CalendarSchedule::getDaytimes(long day, std::vector<long>& daytimes) const {
+  daytimes = getTable(day);
+}
+
+bool CalendarSchedule::getNextFire(long day, long daytimeMS, long& fireDay, long& fireDaytimeMS) const {
+  const std::vector<long>& today = getTable(day);
+  auto next = std::upper_bound(today.begin(), today.end(), daytimeMS);
+  if (next != today.end()) {
+    fireDay = day;
+    fireDaytimeMS = *next;
+    return true;
+  }
+
+  //a non empty segment has a feed within a week unless exceptions remove it, so this is bounded
+  const int maxProbes = 8 * (segments.size() + exceptions.size()) + 7;
+  long probe = day + 1;
+  for (int i = 0; i < maxProbes; i++) {
+    const std::vector<long>& daytimes = getTable(probe);
+    if (!daytimes.empty()) {
+      fireDay = probe;
+      fireDaytimeMS = daytimes.front();
+      return true;
+    }
+
+    long nextProbe = probe + 1;
+    const int segment = findSegment(probe);
+    if (segments[segment].Empty) {
+      //jump to the next segment or exception, whatever comes first
+      const bool lastSegment = segment + 1 >= (int)segments.size();
+      auto exception = std::upper_bound(exceptions.begin(), exceptions.end(), probe, [](long value, const CalendarException& exception) {
+        return value < exception.Day;
+      });
+      if (lastSegment && exception == exceptions.end()) {
+        return false;
+      }
+      nextProbe = lastSegment ? exception->Day : segments[segment + 1].FirstDay;
+      if (exception != exceptions.end()) {
+        nextProbe = std::min(nextProbe, exception->Day);
+      }
+    }
+    probe = nextProbe;
+  }
+
+  return false;
+}
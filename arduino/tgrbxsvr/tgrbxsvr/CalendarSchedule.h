@@ -0,0 +1,65 @@
+#ifndef CALENDARSCHEDULE_H
+#define CALENDARSCHEDULE_H
+
+#include <vector>
+#include <stdint.h>
+
+//Calendar schedule: feed daytimes per weekday, optionally limited to a date range, plus exceptions for single dates.
+//The rules are stored as compact text, separated by ';':
+//
+//  <weekday mask>/<first day>-<last day>/<minute>,<minute>,...
+//      weekday mask in hex, bit 0 = Monday ... bit 6 = Sunday,
+//      days since 1970-01-01 (unix day), 0 = open range, minutes since midnight
+//  !<day>/<minute>,<minute>,...
+//      exception, replaces all rules on that day, no minutes = no feed
+//
+//  e.g. "1f/0-0/420,1080;60/0-0/540,1140;!19700/" = Mon-Fri 7:00 and 18:00, Sat+Sun 9:00 and 19:00, no feed on day 19700
+//
+//compile() splits the calendar into segments at the date range boundaries, every segment has one sorted
+//daytime table per weekday. A day lookup is a binary search over the exceptions and segments, so the next fire
+//time is found in O(log n) per probed day. Empty segments are skipped as a whole.
+//Plain C++ without Arduino dependencies.
+
+const int CALENDAR_MAX_RULES = 32;
+
+struct CalendarRule {
+  uint8_t Weekdays;  //bit 0 = Monday
+  long FirstDay;     //0 = open
+  long LastDay;      //0 = open
+  std::vector<long> Daytimes;  //ms since midnight
+};
+
+struct CalendarException {
+  long Day;
+  std::vector<long> Daytimes;  //ms since midnight, empty = no feed
+};
+
+class CalendarSchedule {
+public:
+  CalendarSchedule();
+  bool compile(const char* rules);  //false if the rules are invalid, the schedule is empty then
+  void clear();
+  void getDaytimes(long day, std::vector<long>& daytimes) const;
+  //first fire time after daytimeMS on day, false if there is none
+  bool getNextFire(long day, long daytimeMS, long& fireDay, long& fireDaytimeMS) const;
+  static int getWeekday(long day);  //0 = Monday
+
+private:
+  struct Segment {
+    long FirstDay;
+    int Tables[7];  //index in tables per weekday
+    bool Empty;
+  };
+
+  bool parse(const char* rules, std::vector<CalendarRule>& parsedRules);
+  int addTable(std::vector<long>& daytimes);
+  const std::vector<long>& getTable(long day) const;
+  int findSegment(long day) const;
+  const CalendarException* findException(long day) const;
+
+  std::vector<Segment> segments;      //sorted by FirstDay, the first one starts at day 0
+  std::vector<std::vector<long>> tables;  //distinct sorted daytime tables, 0 is the empty one
+  std::vector<CalendarException> exceptions;  //sorted by day
+};
+
+#endif
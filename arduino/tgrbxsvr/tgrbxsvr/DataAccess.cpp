@@ -6,6 +6,7 @@
 #include <stdio.h>
 #include <sqlite3.h>
 #include <stdlib.h>
+#include <algorithm>
 
 bool initialized = false;
 
@@ -24,10 +25,17 @@ String systemDbPath = dbPrefix + dbRootPath + "/System.db";
 String historyDbPath = dbPrefix + dbRootPath + "/History.db";
 String userDbPath = dbPrefix + dbRootPath + "/User.db";
 
+//storage task only
 sqlite3 *dbSystem;
 sqlite3 *dbHistory;
 sqlite3 *dbUser;
 
+const int STORAGE_CORE = 1;
+const int STORAGE_PRIORITY = 1;
+const int STORAGE_STACK_SIZE = 16384;  //sqlite needs a deep stack
+const int INTERACTIVE_QUEUE_LENGTH = 8;
+const int BACKGROUND_QUEUE_LENGTH = 32;
+
 int openDb(const char *filename, sqlite3 **db) {
   int rc = sqlite3_open(filename, db);
   if (rc) {
@@ -44,8 +52,8 @@ const char *sqlite3_column_string(sqlite3_stmt *stmt, int index) {
 }
 
 int insertScheduleToDB(Schedule *schedule, sqlite3 *db) {
-  const char *sql = "INSERT INTO Schedules (CreatedOn, Name, Mode, Selected, Active, Daytimes, MaxTimes, MaxTimesStartTime, OnlyWhenEmpty) "
-                    "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)";
+  const char *sql = "INSERT INTO Schedules (CreatedOn, Name, Mode, Selected, Active, Daytimes, MaxTimes, MaxTimesStartTime, OnlyWhenEmpty, DispenseMode, Rules, MinFeedSpacing, RollingLimit) "
+                    "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
 
   sqlite3_stmt *stmt;
   int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
@@ -60,6 +68,10 @@ int insertScheduleToDB(Schedule *schedule, sqlite3 *db) {
   sqlite3_bind_int(stmt, 7, schedule->MaxTimes);
   sqlite3_bind_int64(stmt, 8, schedule->MaxTimesStartTime);
   sqlite3_bind_int(stmt, 9, schedule->OnlyWhenEmpty ? 1 : 0);
+  sqlite3_bind_int(stmt, 10, schedule->DispenseMode);
+  sqlite3_bind_text(stmt, 11, schedule->Rules.c_str(), strlen(schedule->Rules.c_str()), SQLITE_TRANSIENT);
+  sqlite3_bind_int64(stmt, 12, schedule->MinFeedSpacing);
+  sqlite3_bind_int(stmt, 13, schedule->RollingLimit);
 
   rc = sqlite3_step(stmt);
   if (rc != SQLITE_DONE) {
@@ -89,11 +101,11 @@ bool DataAccess::init() {
 
   sqlite3_initialize();
 
-  initialized = true;
-  return true;
+  initialized = startStorageTask();
+  return initialized;
 }
 
-Config *DataAccess::getConfig() {
+Config *DataAccess::dbGetConfig() {
   if (!SD.exists(configPath)) {
     Serial.println(F("Config file not found"));
     return nullptr;
@@ -119,7 +131,7 @@ Config *DataAccess::getConfig() {
 
 //--- DB: System ---
 
-SystemSettings *DataAccess::getSystemSettings() {
+SystemSettings *DataAccess::dbGetSystemSettings() {
   if (openDb(systemDbPath.c_str(), &dbSystem)) {
     Serial.println("Couldnt open dbSystem!");
     return nullptr;
@@ -141,6 +153,9 @@ SystemSettings *DataAccess::getSystemSettings() {
     settings->PlateOffset = sqlite3_column_int(stmt, 4);
     settings->ContainerAngleClose = sqlite3_column_int(stmt, 5);
     settings->ContainerAngleOpen = sqlite3_column_int(stmt, 6);
+    settings->ContainerScaleQuadratic = sqlite3_column_double(stmt, 7);
+    settings->PlateScaleQuadratic = sqlite3_column_double(stmt, 8);
+    settings->ContainerCloseLatency = sqlite3_column_double(stmt, 9);
   } else {
     Serial.printf("ERROR executing stmt: %s\n", sqlite3_errmsg(dbSystem));
   }
@@ -150,7 +165,7 @@ SystemSettings *DataAccess::getSystemSettings() {
   return settings;
 }
 
-bool DataAccess::updateSystemSettings(SystemSettings* settings){
+bool DataAccess::dbUpdateSystemSettings(SystemSettings* settings){
   if (openDb(systemDbPath.c_str(), &dbSystem)) {
     Serial.println("Couldnt open dbSystem!");
     return false;
@@ -163,7 +178,10 @@ bool DataAccess::updateSystemSettings(SystemSettings* settings){
               "PlateScale = ?,"
               "PlateOffset = ?,"
               "ContainerAngleClose = ?,"
-              "ContainerAngleOpen = ? ";
+              "ContainerAngleOpen = ?,"
+              "ContainerScaleQuadratic = ?,"
+              "PlateScaleQuadratic = ?,"
+              "ContainerCloseLatency = ? ";
 
   sqlite3_stmt *stmt;
 
@@ -176,6 +194,9 @@ bool DataAccess::updateSystemSettings(SystemSettings* settings){
   sqlite3_bind_int(stmt, 5, settings->PlateOffset);
    sqlite3_bind_double(stmt, 6, settings->ContainerAngleClose);
     sqlite3_bind_double(stmt, 7, settings->ContainerAngleOpen);
+  sqlite3_bind_double(stmt, 8, settings->ContainerScaleQuadratic);
+  sqlite3_bind_double(stmt, 9, settings->PlateScaleQuadratic);
+  sqlite3_bind_double(stmt, 10, settings->ContainerCloseLatency);
 
   rc = sqlite3_step(stmt);
   if (rc != SQLITE_DONE) {
@@ -189,7 +210,7 @@ bool DataAccess::updateSystemSettings(SystemSettings* settings){
 
 //--- DB: History ---
 
-int DataAccess::getNumFedFromTo(long from, long to) {
+int DataAccess::dbGetNumFedFromTo(long from, long to) {
   if (openDb(historyDbPath.c_str(), &dbHistory)) {
     Serial.println("Couldnt open dbHistory!");
     return 0;
@@ -216,7 +237,36 @@ int DataAccess::getNumFedFromTo(long from, long to) {
   return count;
 }
 
-long DataAccess::getLastFedTimestampBefore(long before) {
+void DataAccess::dbGetFedTimestampsFromTo(long from, long to, std::vector<long> &timestamps) {
+  if (openDb(historyDbPath.c_str(), &dbHistory)) {
+    Serial.println("Couldnt open dbHistory!");
+    return;
+  }
+
+  char *sql = "SELECT CreatedOn FROM Events WHERE Type = ? AND CreatedOn >= ? AND CreatedOn < ? ORDER BY CreatedOn";
+  sqlite3_stmt *stmt;
+
+  int rc = sqlite3_prepare_v2(dbHistory, sql, -1, &stmt, NULL);
+  rc = sqlite3_bind_int(stmt, 1, Feed);
+  rc = sqlite3_bind_int64(stmt, 2, from);
+  rc = sqlite3_bind_int64(stmt, 3, to);
+
+  do {
+    rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+      timestamps.push_back((long)sqlite3_column_int64(stmt, 0));
+    }
+  } while (rc == SQLITE_ROW);
+
+  if (rc != SQLITE_DONE) {
+    Serial.printf("ERROR executing stmt: %s\n", sqlite3_errmsg(dbHistory));
+  }
+
+  sqlite3_finalize(stmt);
+  sqlite3_close(dbHistory);
+}
+
+long DataAccess::dbGetLastFedTimestampBefore(long before) {
   if (openDb(historyDbPath.c_str(), &dbHistory)) {
     Serial.println("Couldnt open dbHistory!");
     return 0;
@@ -244,7 +294,7 @@ long DataAccess::getLastFedTimestampBefore(long before) {
   return lastFedTimestamp;
 }
 
-bool DataAccess::logEventHistory(Event event) {
+bool DataAccess::dbLogEventHistory(Event event) {
   if (openDb(historyDbPath.c_str(), &dbHistory)) {
     Serial.println("Couldnt open dbHistory!");
     return 0;
@@ -268,7 +318,35 @@ bool DataAccess::logEventHistory(Event event) {
   return rc == SQLITE_DONE;
 };
 
-bool DataAccess::logScaleHistory(std::vector<ScaleData> &scaleData) {
+bool DataAccess::dbLogFeedHistory(FeedResult feed) {
+  if (openDb(historyDbPath.c_str(), &dbHistory)) {
+    Serial.println("Couldnt open dbHistory!");
+    return 0;
+  }
+
+  const char *sql = "INSERT INTO Feeds (CreatedOn, Requested, Dispensed, Overshoot, FlowRate, CloseLatency) VALUES (?, ?, ?, ?, ?, ?)";
+
+  sqlite3_stmt *stmt;
+  int rc = sqlite3_prepare_v2(dbHistory, sql, -1, &stmt, NULL);
+
+  sqlite3_bind_int64(stmt, 1, feed.CreatedOn);
+  sqlite3_bind_double(stmt, 2, feed.Requested);
+  sqlite3_bind_double(stmt, 3, feed.Dispensed);
+  sqlite3_bind_double(stmt, 4, feed.Overshoot);
+  sqlite3_bind_double(stmt, 5, feed.FlowRate);
+  sqlite3_bind_double(stmt, 6, feed.CloseLatency);
+
+  rc = sqlite3_step(stmt);
+  if (rc != SQLITE_DONE) {
+    Serial.printf("ERROR executing stmt: %s\n", sqlite3_errmsg(dbHistory));
+  }
+
+  rc = sqlite3_finalize(stmt);
+  sqlite3_close(dbHistory);
+  return rc == SQLITE_OK;
+};
+
+bool DataAccess::dbLogScaleHistory(const ScaleData *scaleData, int count) {
   if (openDb(historyDbPath.c_str(), &dbHistory)) {
     Serial.println("Couldnt open dbHistory!");
     return 0;
@@ -279,7 +357,8 @@ bool DataAccess::logScaleHistory(std::vector<ScaleData> &scaleData) {
   const char *sql = "INSERT INTO ScaleData (CreatedOn, ScaleID, Value) VALUES (?, ?, ?)";
   rc = sqlite3_prepare_v2(dbHistory, sql, -1, &stmt, NULL);
 
-  for (ScaleData data : scaleData) {
+  for (int i = 0; i < count; i++) {
+    const ScaleData &data = scaleData[i];
     sqlite3_bind_int64(stmt, 1, data.CreatedOn);
     sqlite3_bind_int(stmt, 2, data.ScaleID);
     sqlite3_bind_double(stmt, 3, data.Value);
@@ -294,7 +373,7 @@ bool DataAccess::logScaleHistory(std::vector<ScaleData> &scaleData) {
   return rc == SQLITE_DONE;
 };
 
-bool DataAccess::logScheduleHistory(Schedule *schedule) {
+bool DataAccess::dbLogScheduleHistory(Schedule *schedule) {
   if (openDb(historyDbPath.c_str(), &dbHistory)) {
     Serial.println("Couldnt open dbHistory!");
     return 0;
@@ -306,7 +385,7 @@ bool DataAccess::logScheduleHistory(Schedule *schedule) {
 
 //--- DB: User ---
 
-UserSettings *DataAccess::getUserSettings() {
+UserSettings *DataAccess::dbGetUserSettings() {
   if (openDb(userDbPath.c_str(), &dbUser)) {
     Serial.println("Couldnt open dbUser!");
     return nullptr;
@@ -345,7 +424,7 @@ UserSettings *DataAccess::getUserSettings() {
   return settings;
 }
 
-bool DataAccess::updateUserSettings(UserSettings *userSettings) {
+bool DataAccess::dbUpdateUserSettings(UserSettings *userSettings) {
   if (openDb(userDbPath.c_str(), &dbUser)) {
     Serial.println("Couldnt open dbUser!");
     return false;
@@ -401,10 +480,14 @@ Schedule *readScheduleRow(sqlite3_stmt *stmt) {
   schedule->MaxTimes = sqlite3_column_int(stmt, 7);
   schedule->MaxTimesStartTime = sqlite3_column_int64(stmt, 8);
   schedule->OnlyWhenEmpty = sqlite3_column_int(stmt, 9) == 1;
+  schedule->DispenseMode = sqlite3_column_int(stmt, 10);
+  schedule->Rules = sqlite3_column_string(stmt, 11);
+  schedule->MinFeedSpacing = sqlite3_column_int64(stmt, 12);
+  schedule->RollingLimit = sqlite3_column_int(stmt, 13);
   return schedule;
 }
 
-Schedule *DataAccess::getSelectedSchedule() {
+Schedule *DataAccess::dbGetSelectedSchedule() {
   if (openDb(userDbPath.c_str(), &dbUser)) {
     Serial.println("Couldnt open dbUser!");
     return nullptr;
@@ -429,7 +512,7 @@ Schedule *DataAccess::getSelectedSchedule() {
   return schedulePointer;
 }
 
-bool DataAccess::setSelectSchedule(int scheduleID, bool selected) {
+bool DataAccess::dbSetSelectSchedule(int scheduleID, bool selected) {
   if (openDb(userDbPath.c_str(), &dbUser)) {
     Serial.println("Couldnt open dbUser!");
     return false;
@@ -456,7 +539,7 @@ bool DataAccess::setSelectSchedule(int scheduleID, bool selected) {
   return rc == SQLITE_OK;
 }
 
-bool DataAccess::setActiveSchedule(int scheduleID, bool active) {
+bool DataAccess::dbSetActiveSchedule(int scheduleID, bool active) {
   if (openDb(userDbPath.c_str(), &dbUser)) {
     Serial.println("Couldnt open dbUser!");
     return false;
@@ -483,7 +566,7 @@ bool DataAccess::setActiveSchedule(int scheduleID, bool active) {
   return rc == SQLITE_OK;
 }
 
-void DataAccess::getAllSchedules(std::vector<Schedule> &schedules) {
+void DataAccess::dbGetAllSchedules(std::vector<Schedule> &schedules) {
   if (openDb(userDbPath.c_str(), &dbUser)) {
     Serial.println("Couldnt open dbUser!");
   }
@@ -510,7 +593,7 @@ void DataAccess::getAllSchedules(std::vector<Schedule> &schedules) {
   sqlite3_close(dbUser);
 }
 
-Schedule *DataAccess::getScheduleByID(int id) {
+Schedule *DataAccess::dbGetScheduleByID(int id) {
   if (openDb(userDbPath.c_str(), &dbUser)) {
     Serial.println("Couldnt open dbUser!");
     return nullptr;
@@ -536,7 +619,7 @@ Schedule *DataAccess::getScheduleByID(int id) {
   return schedulePointer;
 }
 
-int DataAccess::insertSchedule(Schedule *schedule) {
+int DataAccess::dbInsertSchedule(Schedule *schedule) {
   if (openDb(userDbPath.c_str(), &dbUser)) {
     Serial.println("Couldnt open dbUser!");
     return 0;
@@ -546,14 +629,14 @@ int DataAccess::insertSchedule(Schedule *schedule) {
   return newID;
 }
 
-bool DataAccess::updateSchedule(Schedule *schedule) {
+bool DataAccess::dbUpdateSchedule(Schedule *schedule) {
   if (openDb(userDbPath.c_str(), &dbUser)) {
     Serial.println("Couldnt open dbUser!");
     return false;
   }
 
   const char *sql = "UPDATE Schedules "
-                    "SET CreatedOn=?, Name=?, Mode=?, Selected=?, Active=?, Daytimes=?, MaxTimes=?, MaxTimesStartTime=?, OnlyWhenEmpty=? "
+                    "SET CreatedOn=?, Name=?, Mode=?, Selected=?, Active=?, Daytimes=?, MaxTimes=?, MaxTimesStartTime=?, OnlyWhenEmpty=?, DispenseMode=?, Rules=?, MinFeedSpacing=?, RollingLimit=? "
                     "WHERE ID=?";
 
   sqlite3_stmt *stmt;
@@ -569,7 +652,11 @@ bool DataAccess::updateSchedule(Schedule *schedule) {
   sqlite3_bind_int(stmt, 7, schedule->MaxTimes);
   sqlite3_bind_int64(stmt, 8, schedule->MaxTimesStartTime);
   sqlite3_bind_int(stmt, 9, schedule->OnlyWhenEmpty ? 1 : 0);
-  sqlite3_bind_int(stmt, 10, schedule->ID);
+  sqlite3_bind_int(stmt, 10, schedule->DispenseMode);
+  sqlite3_bind_text(stmt, 11, schedule->Rules.c_str(), strlen(schedule->Rules.c_str()), SQLITE_TRANSIENT);
+  sqlite3_bind_int64(stmt, 12, schedule->MinFeedSpacing);
+  sqlite3_bind_int(stmt, 13, schedule->RollingLimit);
+  sqlite3_bind_int(stmt, 14, schedule->ID);
 
   rc = sqlite3_step(stmt);
   if (rc != SQLITE_DONE) {
@@ -581,7 +668,7 @@ bool DataAccess::updateSchedule(Schedule *schedule) {
   return rc == SQLITE_OK;
 }
 
-bool DataAccess::deleteSchedule(int scheduleID) {
+bool DataAccess::dbDeleteSchedule(int scheduleID) {
   if (openDb(userDbPath.c_str(), &dbUser)) {
     Serial.println("Couldnt open dbUser!");
     return false;
@@ -601,4 +688,229 @@ bool DataAccess::deleteSchedule(int scheduleID) {
   rc = sqlite3_finalize(stmt);
   sqlite3_close(dbUser);
   return rc == SQLITE_OK;
-}
\ No newline at end of file
+}
+
+//--- Storage task ---
+
+void storageTask(void *pvParameters) {
+  DataAccess *dataAccess = (DataAccess *)pvParameters;
+  for (;;) {
+    dataAccess->serveRequest();
+  }
+}
+
+bool DataAccess::startStorageTask() {
+  interactiveQueue = xQueueCreate(INTERACTIVE_QUEUE_LENGTH, sizeof(StorageRequest *));
+  backgroundQueue = xQueueCreate(BACKGROUND_QUEUE_LENGTH, sizeof(BackgroundWrite));
+  pendingRequests = xSemaphoreCreateCounting(INTERACTIVE_QUEUE_LENGTH + BACKGROUND_QUEUE_LENGTH, 0);
+  if (interactiveQueue == nullptr || backgroundQueue == nullptr || pendingRequests == nullptr) {
+    Serial.println("Couldnt create storage queues!");
+    return false;
+  }
+  return xTaskCreatePinnedToCore(storageTask, "Storage", STORAGE_STACK_SIZE, this, STORAGE_PRIORITY, NULL, STORAGE_CORE) == pdPASS;
+}
+
+//interactive requests first, the background writes run when nobody waits
+void DataAccess::serveRequest() {
+  xSemaphoreTake(pendingRequests, portMAX_DELAY);
+  StorageRequest *request;
+  if (xQueueReceive(interactiveQueue, &request, 0) == pdTRUE) {
+    request->Job();
+    xSemaphoreGive(request->Done);
+    return;
+  }
+
+  BackgroundWrite write;
+  if (xQueueReceive(backgroundQueue, &write, 0) == pdTRUE) {
+    runBackgroundWrite(write);
+  }
+}
+
+void DataAccess::runBackgroundWrite(BackgroundWrite &write) {
+  switch (write.Type) {
+    case SystemSettingsWrite:
+      dbUpdateSystemSettings(&write.Settings);
+      break;
+    case EventWrite:
+      dbLogEventHistory(write.HistoryEvent);
+      break;
+    case FeedWrite:
+      dbLogFeedHistory(write.Feed);
+      break;
+    case ScaleDataWrite:
+      dbLogScaleHistory(write.Readings, write.Count);
+      break;
+    case ScheduleWrite:
+      dbLogScheduleHistory(write.HistorySchedule);
+      delete write.HistorySchedule;
+      break;
+  }
+}
+
+//runs the job on the storage task and waits for it
+void DataAccess::call(std::function<void()> job) {
+  if (interactiveQueue == nullptr) {
+    //storage task not started yet
+    job();
+    return;
+  }
+
+  StorageRequest request;
+  request.Job = job;
+  request.Done = xSemaphoreCreateBinary();
+  StorageRequest *requestPointer = &request;
+  xQueueSend(interactiveQueue, &requestPointer, portMAX_DELAY);
+  xSemaphoreGive(pendingRequests);
+  xSemaphoreTake(request.Done, portMAX_DELAY);
+  vSemaphoreDelete(request.Done);
+}
+
+//queues a copy of the write without waiting
+bool DataAccess::post(const BackgroundWrite &write) {
+  if (backgroundQueue == nullptr) {
+    return false;
+  }
+
+  if (xQueueSend(backgroundQueue, &write, 0) != pdTRUE) {
+    Serial.println("Storage queue full, dropped write");
+    return false;
+  }
+  xSemaphoreGive(pendingRequests);
+  return true;
+}
+
+Config *DataAccess::getConfig() {
+  Config *config = nullptr;
+  call([&] { config = dbGetConfig(); });
+  return config;
+}
+
+SystemSettings *DataAccess::getSystemSettings() {
+  SystemSettings *settings = nullptr;
+  call([&] { settings = dbGetSystemSettings(); });
+  return settings;
+}
+
+bool DataAccess::updateSystemSettings(SystemSettings *settings) {
+  bool success = false;
+  call([&] { success = dbUpdateSystemSettings(settings); });
+  return success;
+}
+
+bool DataAccess::updateSystemSettingsAsync(SystemSettings settings) {
+  BackgroundWrite write;
+  write.Type = SystemSettingsWrite;
+  write.Settings = settings;
+  return post(write);
+}
+
+int DataAccess::getNumFedFromTo(long from, long to) {
+  int count = 0;
+  call([&] { count = dbGetNumFedFromTo(from, to); });
+  return count;
+}
+
+void DataAccess::getFedTimestampsFromTo(long from, long to, std::vector<long> &timestamps) {
+  call([&] { dbGetFedTimestampsFromTo(from, to, timestamps); });
+}
+
+long DataAccess::getLastFedTimestampBefore(long before) {
+  long lastFedTimestamp = 0;
+  call([&] { lastFedTimestamp = dbGetLastFedTimestampBefore(before); });
+  return lastFedTimestamp;
+}
+
+bool DataAccess::logEventHistory(Event event) {
+  BackgroundWrite write;
+  write.Type = EventWrite;
+  write.HistoryEvent = event;
+  return post(write);
+}
+
+bool DataAccess::logFeedHistory(FeedResult feed) {
+  BackgroundWrite write;
+  write.Type = FeedWrite;
+  write.Feed = feed;
+  return post(write);
+}
+
+bool DataAccess::logScaleHistory(const std::vector<ScaleData> &scaleData) {
+  BackgroundWrite write;
+  write.Type = ScaleDataWrite;
+  bool success = true;
+  for (size_t first = 0; first < scaleData.size(); first += SCALE_DATA_BATCH) {
+    write.Count = min(scaleData.size() - first, (size_t)SCALE_DATA_BATCH);
+    std::copy(scaleData.begin() + first, scaleData.begin() + first + write.Count, write.Readings);
+    success = post(write) && success;
+  }
+  return success;
+}
+
+bool DataAccess::logScheduleHistory(Schedule *schedule) {
+  BackgroundWrite write;
+  write.Type = ScheduleWrite;
+  write.HistorySchedule = new Schedule(*schedule);
+  if (!post(write)) {
+    delete write.HistorySchedule;
+    return false;
+  }
+  return true;
+}
+
+UserSettings *DataAccess::getUserSettings() {
+  UserSettings *settings = nullptr;
+  call([&] { settings = dbGetUserSettings(); });
+  return settings;
+}
+
+bool DataAccess::updateUserSettings(UserSettings *userSettings) {
+  bool success = false;
+  call([&] { success = dbUpdateUserSettings(userSettings); });
+  return success;
+}
+
+Schedule *DataAccess::getSelectedSchedule() {
+  Schedule *schedule = nullptr;
+  call([&] { schedule = dbGetSelectedSchedule(); });
+  return schedule;
+}
+
+bool DataAccess::setSelectSchedule(int scheduleID, bool selected) {
+  bool success = false;
+  call([&] { success = dbSetSelectSchedule(scheduleID, selected); });
+  return success;
+}
+
+bool DataAccess::setActiveSchedule(int scheduleID, bool active) {
+  bool success = false;
+  call([&] { success = dbSetActiveSchedule(scheduleID, active); });
+  return success;
+}
+
+void DataAccess::getAllSchedules(std::vector<Schedule> &schedules) {
+  call([&] { dbGetAllSchedules(schedules); });
+}
+
+Schedule *DataAccess::getScheduleByID(int id) {
+  Schedule *schedule = nullptr;
+  call([&] { schedule = dbGetScheduleByID(id); });
+  return schedule;
+}
+
+int DataAccess::insertSchedule(Schedule *schedule) {
+  int id = 0;
+  call([&] { id = dbInsertSchedule(schedule); });
+  return id;
+}
+
+bool DataAccess::updateSchedule(Schedule *schedule) {
+  bool success = false;
+  call([&] { success = dbUpdateSchedule(schedule); });
+  return success;
+}
+
+bool DataAccess::deleteSchedule(int scheduleID) {
+  bool success = false;
+  call([&] { success = dbDeleteSchedule(scheduleID); });
+  return success;
+}
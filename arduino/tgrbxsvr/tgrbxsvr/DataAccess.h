@@ -1,12 +1,48 @@
 #ifndef DATAACESS_H
 #define DATAACESS_H
 
+#include "freertos/FreeRTOS.h"
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <functional>
 #include "Models.h"
 #include <vector>
 
 
 extern void printRam();
 
+//one interactive unit of work for the storage task, lives on the stack of the waiting caller
+struct StorageRequest {
+  std::function<void()> Job;
+  SemaphoreHandle_t Done;  //given when the job ran
+};
+
+const int SCALE_DATA_BATCH = 8;  //scale readings per background write
+
+enum BackgroundWriteType {
+  SystemSettingsWrite,
+  EventWrite,
+  FeedWrite,
+  ScaleDataWrite,
+  ScheduleWrite
+};
+
+//background write of the control loop, copied into the queue storage, so queuing does not touch the heap
+struct BackgroundWrite {
+  BackgroundWriteType Type;
+  int Count;  //ScaleDataWrite
+  union {
+    SystemSettings Settings;
+    Event HistoryEvent;
+    FeedResult Feed;
+    ScaleData Readings[SCALE_DATA_BATCH];
+    Schedule *HistorySchedule;  //copy owned by the write, schedule changes are rare and allocate anyway
+  };
+};
+
+//SD card and databases are owned by one storage task (actor), all methods hand their work to it.
+//Getters and updates wait for the result, interactive requests (REST handlers, commands) are served before
+//the background log writes of the control loop, which return as soon as they are queued
 class DataAccess {
 
 public:
@@ -17,13 +53,17 @@ public:
 
   SystemSettings *getSystemSettings();
   bool updateSystemSettings(SystemSettings* settings);
+  bool updateSystemSettingsAsync(SystemSettings settings);  //background, false if the queue is full
 
   //--- DB: History ---
+  //log methods are background requests, false if the queue is full
 
   int getNumFedFromTo(long from, long to);
+  void getFedTimestampsFromTo(long from, long to, std::vector<long>& timestamps);  //oldest first
   long getLastFedTimestampBefore(long before);
   bool logEventHistory(Event event);
-  bool logScaleHistory(std::vector<ScaleData>& scaleData);
+  bool logFeedHistory(FeedResult feed);
+  bool logScaleHistory(const std::vector<ScaleData>& scaleData);  //in batches of SCALE_DATA_BATCH
   bool logScheduleHistory(Schedule *schedule);
 
   //--- DB: User ---
@@ -39,7 +79,40 @@ public:
   int insertSchedule(Schedule* schedule);
   bool updateSchedule(Schedule* schedule);
   bool deleteSchedule(int scheduleID);
-  
+
+  void serveRequest();  //storage task only
+
+private:
+  bool startStorageTask();
+  void call(std::function<void()> job);
+  bool post(const BackgroundWrite& write);
+  void runBackgroundWrite(BackgroundWrite& write);
+
+  //executed by the storage task
+  Config *dbGetConfig();
+  SystemSettings *dbGetSystemSettings();
+  bool dbUpdateSystemSettings(SystemSettings* settings);
+  int dbGetNumFedFromTo(long from, long to);
+  void dbGetFedTimestampsFromTo(long from, long to, std::vector<long>& timestamps);
+  long dbGetLastFedTimestampBefore(long before);
+  bool dbLogEventHistory(Event event);
+  bool dbLogFeedHistory(FeedResult feed);
+  bool dbLogScaleHistory(const ScaleData *scaleData, int count);
+  bool dbLogScheduleHistory(Schedule *schedule);
+  UserSettings *dbGetUserSettings();
+  bool dbUpdateUserSettings(UserSettings *userSettings);
+  Schedule *dbGetSelectedSchedule();
+  bool dbSetSelectSchedule(int scheduleID, bool selected);
+  bool dbSetActiveSchedule(int scheduleID, bool active);
+  void dbGetAllSchedules(std::vector<Schedule>& schedules);
+  Schedule* dbGetScheduleByID(int id);
+  int dbInsertSchedule(Schedule* schedule);
+  bool dbUpdateSchedule(Schedule* schedule);
+  bool dbDeleteSchedule(int scheduleID);
+
+  QueueHandle_t interactiveQueue = nullptr;
+  QueueHandle_t backgroundQueue = nullptr;
+  SemaphoreHandle_t pendingRequests = nullptr;  //counts the requests in both queues
 };
 
-#endif
\ No newline at end of file
+#endif
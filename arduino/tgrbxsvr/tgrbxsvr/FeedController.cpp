@@ -0,0 +1,267 @@
+#include "FeedController.h"
+#include "MachineController.h"
+#include "MotorSupervisor.h"
+#include <freertos/task.h>
+#include <esp_timer.h>
+
+extern MachineController machineController;
+extern MotorSupervisor motorSupervisor;
+
+//the loop runs the handler of the current state only, a handler returns the next state,
+//the transition is checked against FEED_TRANSITIONS
+const FeedController::StateHandler FeedController::STATE_HANDLERS[NUM_FEED_STATES] = {
+  &FeedController::handleIdle,
+  &FeedController::handleOpening,
+  &FeedController::handleDispensing,
+  &FeedController::handleClosing,
+  &FeedController::handleSettling,
+  &FeedController::handleAborted,
+};
+
+void FeedController::init(double closeLatency) {
+  feedModel.init(closeLatency);
+}
+
+void FeedController::start(MachineStatus& currentStatus, int64_t currentTimestamp, double newTargetWeight, DispenseStrategy newMode) {
+  status = &currentStatus;
+  timestamp = currentTimestamp;
+  previousTimestamp = currentTimestamp;
+  targetWeight = newTargetWeight;
+  mode = newMode;
+
+  feedModel.startFeed(currentTimestamp / 1000, status->ContainerLoad, status->ContainerLoad - targetWeight);
+  if (mode == PulseDispense) {
+    pulseDispenser.start(currentTimestamp, status->ContainerLoad, status->ContainerLoad - targetWeight, CONTAINER_EMPTY_THRESHOLD);
+  } else {
+    flowController.start();
+    openContainer(currentStatus);
+  }
+  stateMachine.transition(FeedOpening, currentTimestamp, esp_timer_get_time());
+}
+
+void FeedController::update(MachineStatus& currentStatus, int64_t currentTimestamp, double currentLoopPeriod) {
+  status = &currentStatus;
+  timestamp = currentTimestamp;
+  loopPeriod = currentLoopPeriod;
+
+  const FeedState state = stateMachine.getState();
+  const FeedState next = (this->*STATE_HANDLERS[state])();
+  if (next != state) {
+    stateMachine.transition(next, timestamp, esp_timer_get_time());
+  }
+  previousTimestamp = timestamp;
+}
+
+void FeedController::updateMeasurement(const MachineStatus& currentStatus, int64_t currentTimestamp) {
+  const bool settled = abs(currentStatus.ContainerFlowRate) <= WEIGHT_D_THRESHOLD && abs(currentStatus.PlateFlowRate) <= WEIGHT_D_THRESHOLD;
+  if (machineController.getSamplingPhase() != MeasuringPhase || !settled
+      || currentTimestamp - containerClosedTimestamp <= SETTLE_TIME * 1000) {
+    return;
+  }
+
+  machineController.setSamplingPhase(IdlePhase);
+  FeedResult result;
+  if (!feedModel.finishFeed(currentStatus.ContainerLoad, result)) {
+    return;
+  }
+
+  Serial.print("Dispensed: ");
+  Serial.print(result.Dispensed);
+  Serial.print(", Overshoot: ");
+  Serial.print(result.Overshoot);
+  Serial.print(", Close latency: ");
+  Serial.println(result.CloseLatency);
+  onFeedResult(result);
+}
+
+void FeedController::openContainer(MachineStatus& currentStatus) {
+  Serial.println("Open Container!");
+  motorSupervisor.open(true);
+  machineController.setSamplingPhase(DispensingPhase);
+  currentStatus.Open = true;
+}
+
+void FeedController::closeContainer(MachineStatus& currentStatus, int64_t currentTimestamp) {
+  Serial.println("Close Container!");
+  motorSupervisor.close(true);
+  machineController.setSamplingPhase(MeasuringPhase);
+  containerClosedTimestamp = currentTimestamp;
+  currentStatus.Open = false;
+}
+
+//delay of the filtered readings: half the moving average depth plus half a reading.
+//The filter averages samples, not loops, the loop runs faster than the sampler while dispensing
+double FeedController::getSensorLatency(const MachineStatus& currentStatus) {
+  const double readTime = currentStatus.SampleRate > 0 ? 1 / currentStatus.SampleRate : 0;
+  return (machineController.getFilterDepth() - 1) / 2.0 * readTime + readTime / 2;
+}
+
+FeedState FeedController::getState() {
+  return stateMachine.getState();
+}
+
+unsigned long FeedController::getTransitionCount() {
+  return stateMachine.getTransitionCount();
+}
+
+FeedTrace FeedController::getTrace() {
+  return stateMachine.getTrace();
+}
+
+//started by start()
+FeedState FeedController::handleIdle() {
+  return FeedIdle;
+}
+
+//the dispensing logic runs from the start, the state only changes once the food flows
+FeedState FeedController::handleOpening() {
+  const FeedState next = dispense();
+  return next == FeedDispensing && -status->ContainerFlowRate <= WEIGHT_D_THRESHOLD ? FeedOpening : next;
+}
+
+FeedState FeedController::handleDispensing() {
+  return dispense();
+}
+
+FeedState FeedController::handleClosing() {
+  //the close check reports a flap that did not close, the feed itself was handled already
+  if (!status->MotorOperation) {
+    reportMotorFailure();
+    return FeedAborted;
+  }
+  if (motorSupervisor.isCloseChecking()) {
+    return FeedClosing;
+  }
+  return -status->ContainerFlowRate > WEIGHT_D_THRESHOLD ? FeedClosing : FeedSettling;
+}
+
+//the final weight is measured by updateMeasurement, a plate that keeps changing (cat eating) ends it by timeout
+FeedState FeedController::handleSettling() {
+  if (machineController.getSamplingPhase() != MeasuringPhase
+      || timestamp - stateMachine.getEnteredAt() > FEED_SETTLE_TIMEOUT) {
+    return FeedIdle;
+  }
+  return FeedSettling;
+}
+
+FeedState FeedController::handleAborted() {
+  return FeedIdle;
+}
+
+//Opening and Dispensing, a finished continuous feed is closed even after a motor failure
+FeedState FeedController::dispense() {
+  if (mode == PulseDispense && status->MotorOperation) {
+    return handlePulseFeeding() ? FeedClosing : FeedDispensing;
+  }
+  closeDelay = 0;
+  if (mode == ContinuousDispense && (feedTargetReached() || status->ContainerLoad <= CONTAINER_EMPTY_THRESHOLD)) {
+    //the reading is older than the close after a delay, the food that left meanwhile is no close latency
+    const double closeLoad = status->ContainerLoad + status->ContainerFlowRate * closeDelay;
+    feedModel.containerClosed(closeLoad, -status->ContainerFlowRate, getSensorLatency(*status));
+    finishFeeding();
+    return FeedClosing;
+  }
+  if (mode == ContinuousDispense && status->MotorOperation) {
+    updateContainerOpening();
+    return FeedDispensing;
+  }
+  abortFeeding();
+  return FeedAborted;
+}
+
+void FeedController::finishFeeding() {
+  Serial.println("Finished feeding");
+  targetWeight = 0;
+  closeContainer(*status, timestamp);
+  onFeedFinished();
+}
+
+void FeedController::abortFeeding() {
+  Serial.println("Abort feeding because Motor fail");
+  targetWeight = 0;
+  reportMotorFailure();
+  onFeedAborted();
+}
+
+//closes (again) and flags the fault until the next finished feed, the supervisor checks the next motion anew
+void FeedController::reportMotorFailure() {
+  closeContainer(*status, timestamp);
+  motorSupervisor.resetMotorOperation();
+  status->MotorOperation = true;
+  onMotorFailure();
+}
+
+//pulses are not supervised by the motor checks, the dispenser detects empty pulses itself.
+//Returns true once the feed is finished
+bool FeedController::handlePulseFeeding() {
+  if (status->Open) {
+    //the pulse duration counts from the fully open flap
+    const double remaining = pulseDispenser.getRemainingPulseTime(timestamp) + machineController.getPulseOpenTime();
+    const double readTime = status->SampleRate > 0 ? 1 / status->SampleRate : 0;
+    if (remaining > loopPeriod + readTime) {
+      return false;
+    }
+    int64_t closedAt = timestamp;
+    if (remaining > 0) {
+      vTaskDelay(pdMS_TO_TICKS(remaining * 1000));
+      closedAt += (int64_t)(remaining * 1000);
+    }
+    motorSupervisor.close(false);
+    machineController.setSamplingPhase(MeasuringPhase);
+    status->Open = false;
+    containerClosedTimestamp = closedAt;
+    pulseDispenser.pulseClosed(closedAt);
+    return false;
+  }
+
+  switch (pulseDispenser.update(timestamp, status->ContainerLoad, status->ContainerFlowRate)) {
+    case PulseOpen:
+      motorSupervisor.pulseOpen();
+      machineController.setSamplingPhase(DispensingPhase);
+      status->Open = true;
+      break;
+    case PulseDone:
+      //measured after settling, nothing left in flight
+      feedModel.containerClosed(status->ContainerLoad, 0, 0);
+      finishFeeding();
+      return true;
+    case PulseEmpty:
+      //ends like a continuous feed on an empty container, the ContainerEmpty notification follows
+      Serial.println("Container empty");
+      feedModel.containerClosed(status->ContainerLoad, 0, 0);
+      finishFeeding();
+      return true;
+    case PulseFailed:
+      motorSupervisor.reportFailure();
+      status->MotorOperation = false;
+      break;
+    case PulseNone:
+      break;
+  }
+  return false;
+}
+
+void FeedController::updateContainerOpening() {
+  const double dt = (double)(timestamp - previousTimestamp) / 1000;
+  const double remaining = status->ContainerLoad - targetWeight;
+  motorSupervisor.setOpening(flowController.update(remaining, -status->ContainerFlowRate, dt));
+}
+
+bool FeedController::feedTargetReached() {
+  const double flowRate = -status->ContainerFlowRate;
+  const double closeTime = feedModel.predictCloseTime(status->ContainerLoad, targetWeight, flowRate, getSensorLatency(*status));
+  const double readTime = status->SampleRate > 0 ? 1 / status->SampleRate : 0;
+
+  if (closeTime <= 0) {
+    return true;
+  }
+
+  if (closeTime < loopPeriod + readTime) {
+    //the next reading would be too late, close at the predicted instant
+    vTaskDelay(pdMS_TO_TICKS(closeTime * 1000));
+    closeDelay = closeTime;
+    return true;
+  }
+
+  return false;
+}
@@ -0,0 +1,76 @@
+#ifndef FEEDCONTROLLER_H
+#define FEEDCONTROLLER_H
+
+#include <stdint.h>
+#include "Models.h"
+#include "FeedModel.h"
+#include "FlowController.h"
+#include "PulseDispenser.h"
+#include "FeedStateMachine.h"
+
+//The dispensing part of an automatic feed, run by the control loop once per loop: opens the container, throttles
+//or pulses it, closes it at the predicted instant and measures the result once the weight settled.
+//The loop decides when a feed starts (schedule, feed window) and handles the outcome in the functions below.
+//The host harness (host/simulate_feed.cpp) runs the same code against the simulated feeder.
+
+const double WEIGHT_D_THRESHOLD = 2;  //in gramm/second
+const double CONTAINER_EMPTY_THRESHOLD = 2;
+const double SETTLE_TIME = 1.5;             //seconds, until the final portion weight is measured with deep filtering
+const int64_t FEED_SETTLE_TIMEOUT = 30000;  //ms, a feed without a stable final weight is done anyway
+
+//implemented by the sketch
+extern void onFeedFinished();  //closed at the target weight or on an empty container
+extern void onFeedAborted();   //a motor failure ended the feed, reported before
+extern void onMotorFailure();
+extern void onFeedResult(const FeedResult& result);  //measured after settling
+
+class FeedController {
+public:
+  void init(double closeLatency);
+  //targetWeight: container load at which the feed is done
+  void start(MachineStatus& status, int64_t timestamp, double targetWeight, DispenseStrategy mode);
+  //runs the handler of the current state, loopPeriod is the time until the next loop in seconds
+  void update(MachineStatus& status, int64_t timestamp, double loopPeriod);
+  //every loop, also after a manual close: ends the measuring phase once the weight settled
+  void updateMeasurement(const MachineStatus& status, int64_t timestamp);
+  void openContainer(MachineStatus& status);
+  void closeContainer(MachineStatus& status, int64_t timestamp);
+  double getSensorLatency(const MachineStatus& status);
+  FeedState getState();
+  unsigned long getTransitionCount();
+  FeedTrace getTrace();  //any task
+
+private:
+  FeedState handleIdle();
+  FeedState handleOpening();
+  FeedState handleDispensing();
+  FeedState handleClosing();
+  FeedState handleSettling();
+  FeedState handleAborted();
+  FeedState dispense();
+  void finishFeeding();
+  void abortFeeding();
+  void reportMotorFailure();
+  bool handlePulseFeeding();
+  void updateContainerOpening();
+  bool feedTargetReached();
+
+  typedef FeedState (FeedController::*StateHandler)();
+  static const StateHandler STATE_HANDLERS[NUM_FEED_STATES];
+
+  FeedStateMachine stateMachine;
+  FeedModel feedModel;
+  PulseDispenser pulseDispenser;
+  FlowController flowController;
+  double targetWeight = 0;
+  DispenseStrategy mode = ContinuousDispense;
+  int64_t containerClosedTimestamp = 0;  //unix in ms
+  double closeDelay = 0;                 //seconds feedTargetReached() waited for the predicted close instant
+  //valid during update
+  MachineStatus* status = nullptr;
+  int64_t timestamp = 0;
+  int64_t previousTimestamp = 0;
+  double loopPeriod = 0;
+};
+
+#endif
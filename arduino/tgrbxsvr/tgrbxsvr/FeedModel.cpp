@@ -0,0 +1,69 @@
+#include "FeedModel.h"
+
+const double MIN_LEARN_FLOW_RATE = 1;  //gramm/second, slower feeds say nothing about the latency
+
+void FeedModel::init(double latency) {
+  closeLatency = latency > 0 && latency <= MAX_CLOSE_LATENCY ? latency : DEFAULT_CLOSE_LATENCY;
+}
+
+void FeedModel::startFeed(long timestamp, double containerLoad, double requestedWeight) {
+  startTimestamp = timestamp;
+  startLoad = containerLoad;
+  requested = requestedWeight;
+  measuring = false;
+}
+
+//flowRate in gramm/second, positive while the container is emptied
+double FeedModel::predictRemainingMass(double flowRate, double sensorLatency) {
+  return max(flowRate, 0.0) * (closeLatency + sensorLatency);
+}
+
+//seconds from now until the container has to be closed, <= 0 if it has to be closed immediately
+double FeedModel::predictCloseTime(double containerLoad, double targetWeight, double flowRate, double sensorLatency) {
+  const double massLeft = containerLoad - predictRemainingMass(flowRate, sensorLatency) - targetWeight;
+  if (massLeft <= 0) {
+    return 0;
+  }
+  if (flowRate <= 0) {
+    return 1e9;
+  }
+  return massLeft / flowRate;
+}
+
+void FeedModel::containerClosed(double containerLoad, double flowRate, double sensorLatency) {
+  closeLoad = containerLoad;
+  closeFlowRate = flowRate;
+  closeSensorLatency = sensorLatency;
+  measuring = true;
+}
+
+bool FeedModel::isMeasuring() {
+  return measuring;
+}
+
+bool FeedModel::finishFeed(double containerLoad, FeedResult& result) {
+  if (!measuring) {
+    return false;
+  }
+  measuring = false;
+
+  if (closeFlowRate >= MIN_LEARN_FLOW_RATE) {
+    //everything after the close command left during sensor latency + close latency
+    const double afterClose = max(closeLoad - containerLoad, 0.0);
+    const double latency = afterClose / closeFlowRate - closeSensorLatency;
+    const double bounded = max(0.0, min(MAX_CLOSE_LATENCY, latency));
+    closeLatency += CLOSE_LATENCY_LEARN_RATE * (bounded - closeLatency);
+  }
+
+  result.CreatedOn = startTimestamp;
+  result.Requested = requested;
+  result.Dispensed = startLoad - containerLoad;
+  result.Overshoot = result.Dispensed - requested;
+  result.FlowRate = closeFlowRate;
+  result.CloseLatency = closeLatency;
+  return true;
+}
+
+double FeedModel::getCloseLatency() {
+  return closeLatency;
+}
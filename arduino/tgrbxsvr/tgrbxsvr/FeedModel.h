@@ -0,0 +1,35 @@
+#ifndef FEEDMODEL_H
+#define FEEDMODEL_H
+
+#include "Models.h"
+
+//Predicts the mass that still leaves the container after closeContainer() is called
+//(flow rate * (servo close latency + sensor latency)) and learns the close latency from past feeds.
+
+const double DEFAULT_CLOSE_LATENCY = 0.3;  //seconds
+const double MAX_CLOSE_LATENCY = 2;        //seconds
+const double CLOSE_LATENCY_LEARN_RATE = 0.3;
+
+class FeedModel {
+public:
+  void init(double closeLatency);
+  void startFeed(long timestamp, double containerLoad, double requestedWeight);
+  double predictRemainingMass(double flowRate, double sensorLatency);
+  double predictCloseTime(double containerLoad, double targetWeight, double flowRate, double sensorLatency);
+  void containerClosed(double containerLoad, double flowRate, double sensorLatency);
+  bool isMeasuring();
+  bool finishFeed(double containerLoad, FeedResult& result);
+  double getCloseLatency();
+
+private:
+  double closeLatency = DEFAULT_CLOSE_LATENCY;
+  bool measuring = false;
+  long startTimestamp = 0;
+  double startLoad = 0;
+  double requested = 0;
+  double closeLoad = 0;
+  double closeFlowRate = 0;
+  double closeSensorLatency = 0;
+};
+
+#endif
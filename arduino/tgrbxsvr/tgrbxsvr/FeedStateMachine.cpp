@@ -0,0 +1,45 @@
+#include "FeedStateMachine.h"
+
+FeedStateMachine::FeedStateMachine()
+  : state(FeedIdle), enteredAt(0), enteredMicros(0), trace() {}
+
+FeedState FeedStateMachine::getState() {
+  return state;
+}
+
+int64_t FeedStateMachine::getEnteredAt() {
+  return enteredAt;
+}
+
+unsigned long FeedStateMachine::getTransitionCount() {
+  return trace.Count;
+}
+
+bool FeedStateMachine::transition(FeedState to, int64_t timestamp, int64_t monotonicMicros) {
+  if (!FEED_TRANSITIONS[state][to]) {
+    Serial.print("Illegal feed transition: ");
+    Serial.print(FEED_STATE_NAMES[state]);
+    Serial.print(" -> ");
+    Serial.println(FEED_STATE_NAMES[to]);
+    return false;
+  }
+
+  FeedTransition& entry = trace.Entries[trace.Count % FEED_TRACE_LENGTH];
+  entry.From = state;
+  entry.To = to;
+  entry.Timestamp = timestamp;
+  entry.Dwell = enteredMicros > 0 ? monotonicMicros - enteredMicros : 0;
+  trace.Count++;
+  publishedTrace.write(trace);
+
+  Serial.print("Feed state: ");
+  Serial.println(FEED_STATE_NAMES[to]);
+  state = to;
+  enteredAt = timestamp;
+  enteredMicros = monotonicMicros;
+  return true;
+}
+
+FeedTrace FeedStateMachine::getTrace() {
+  return publishedTrace.read();
+}
@@ -0,0 +1,102 @@
+#ifndef FEEDSTATEMACHINE_H
+#define FEEDSTATEMACHINE_H
+
+#include <stdint.h>
+#include "Models.h"
+#include "SeqLock.h"
+
+//State of an automatic feed. The allowed transitions are a table checked at compile time,
+//the control loop runs the handler of the current state only and moves along the table.
+//Every transition is recorded with its timestamp and the time spent in the previous state
+//in a ring buffer, readable from any task for latency analysis.
+
+const int FEED_TRACE_LENGTH = 32;
+
+//FEED_TRANSITIONS[from][to]
+constexpr bool FEED_TRANSITIONS[NUM_FEED_STATES][NUM_FEED_STATES] = {
+  //Idle   Opening Dispensing Closing Settling Aborted
+  { false, true, false, false, false, false },  //FeedIdle
+  { false, false, true, true, false, true },    //FeedOpening
+  { false, false, false, true, false, true },   //FeedDispensing
+  { false, false, false, false, true, true },   //FeedClosing
+  { true, false, false, false, false, false },  //FeedSettling
+  { true, false, false, false, false, false },  //FeedAborted
+};
+
+constexpr int countFeedTransitionsFrom(int from, int to = 0) {
+  return to == NUM_FEED_STATES ? 0 : FEED_TRANSITIONS[from][to] + countFeedTransitionsFrom(from, to + 1);
+}
+
+constexpr int countFeedTransitionsTo(int to, int from = 0) {
+  return from == NUM_FEED_STATES ? 0 : FEED_TRANSITIONS[from][to] + countFeedTransitionsTo(to, from + 1);
+}
+
+//every state is entered and left, no state transitions to itself
+constexpr bool feedStatesConnected(int state = 0) {
+  return state == NUM_FEED_STATES
+         || (countFeedTransitionsFrom(state) > 0 && countFeedTransitionsTo(state) > 0
+             && !FEED_TRANSITIONS[state][state] && feedStatesConnected(state + 1));
+}
+
+constexpr bool feedStateReachesIdle(int state, int depth);
+
+constexpr bool feedStateNextReachesIdle(int state, int to, int depth) {
+  return to < NUM_FEED_STATES
+         && ((FEED_TRANSITIONS[state][to] && feedStateReachesIdle(to, depth))
+             || feedStateNextReachesIdle(state, to + 1, depth));
+}
+
+constexpr bool feedStateReachesIdle(int state, int depth) {
+  return state == FeedIdle || (depth > 0 && feedStateNextReachesIdle(state, 0, depth - 1));
+}
+
+constexpr bool allFeedStatesReachIdle(int state = 0) {
+  return state == NUM_FEED_STATES || (feedStateReachesIdle(state, NUM_FEED_STATES) && allFeedStatesReachIdle(state + 1));
+}
+
+static_assert(feedStatesConnected(), "every feed state has to be entered and left");
+static_assert(allFeedStatesReachIdle(), "every feed state has to lead back to FeedIdle");
+static_assert(FEED_TRANSITIONS[FeedOpening][FeedAborted] && FEED_TRANSITIONS[FeedDispensing][FeedAborted]
+                && FEED_TRANSITIONS[FeedClosing][FeedAborted],
+              "a motor failure has to abort a container that is open or closing");
+
+const char* const FEED_STATE_NAMES[NUM_FEED_STATES] = {
+  "Idle",
+  "Opening",
+  "Dispensing",
+  "Closing",
+  "Settling",
+  "Aborted",
+};
+
+struct FeedTransition {
+  FeedState From;
+  FeedState To;
+  int64_t Timestamp;  //unix in ms
+  int64_t Dwell;      //µs spent in From, monotonic
+};
+
+struct FeedTrace {
+  FeedTransition Entries[FEED_TRACE_LENGTH];  //ring, the latest is Entries[(Count - 1) % FEED_TRACE_LENGTH]
+  unsigned long Count;
+};
+
+class FeedStateMachine {
+public:
+  FeedStateMachine();
+  FeedState getState();
+  int64_t getEnteredAt();  //unix in ms
+  unsigned long getTransitionCount();
+  bool transition(FeedState to, int64_t timestamp, int64_t monotonicMicros);  //false if not in the table
+
+  FeedTrace getTrace();  //any task
+
+private:
+  FeedState state;
+  int64_t enteredAt;
+  int64_t enteredMicros;
+  FeedTrace trace;
+  SeqLock<FeedTrace> publishedTrace;
+};
+
+#endif
@@ -0,0 +1,51 @@
+#include "FeedTimeTable.h"
+#include <algorithm>
+
+FeedTimeTable::FeedTimeTable()
+  : cursor(0) {}
+
+void FeedTimeTable::compile(const std::vector<long>& newDaytimes, long handledUntil) {
+  daytimes.clear();
+  for (long daytime : newDaytimes) {
+    if (daytime >= 0 && daytime < MS_PER_DAY) {
+      daytimes.push_back(daytime);
+    }
+  }
+  std::sort(daytimes.begin(), daytimes.end());
+  daytimes.erase(std::unique(daytimes.begin(), daytimes.end()), daytimes.end());
+  daytimes.shrink_to_fit();
+
+  cursor = std::upper_bound(daytimes.begin(), daytimes.end(), handledUntil) - daytimes.begin();
+}
+
+void FeedTimeTable::clear() {
+  daytimes.clear();
+  cursor = 0;
+}
+
+bool FeedTimeTable::isDue(long daytimeMS) {
+  return cursor < (int)daytimes.size() && daytimes[cursor] <= daytimeMS;
+}
+
+//missed daytimes are handled together, like a single feed
+void FeedTimeTable::advance(long daytimeMS) {
+  while (cursor < (int)daytimes.size() && daytimes[cursor] <= daytimeMS) {
+    cursor++;
+  }
+}
+
+void FeedTimeTable::newDay() {
+  cursor = 0;
+}
+
+long FeedTimeTable::getNextDaytime() {
+  return cursor < (int)daytimes.size() ? daytimes[cursor] : -1;
+}
+
+long FeedTimeTable::getFirstDaytime() {
+  return daytimes.empty() ? -1 : daytimes.front();
+}
+
+int FeedTimeTable::getCount() {
+  return daytimes.size();
+}
@@ -0,0 +1,29 @@
+#ifndef FEEDTIMETABLE_H
+#define FEEDTIMETABLE_H
+
+#include <vector>
+
+const long MS_PER_DAY = 86400000L;
+
+//Feed daytimes of a FixedDaytime schedule, compiled once when the schedule is set.
+//The table is sorted and does not change afterwards, a cursor points to the next daytime that is not handled yet.
+//Checking if a feed is due is O(1), the cursor only moves when a feed is handled or the day rolls over.
+class FeedTimeTable {
+public:
+  FeedTimeTable();
+  //handledUntil: ms since midnight up to which the daytimes of today are already handled, -1 for none
+  void compile(const std::vector<long>& daytimes, long handledUntil);
+  void clear();
+  bool isDue(long daytimeMS);
+  void advance(long daytimeMS);  //marks all daytimes up to daytimeMS as handled
+  void newDay();
+  long getNextDaytime();  //-1 if there is none left today
+  long getFirstDaytime();  //-1 if the table is empty
+  int getCount();
+
+private:
+  std::vector<long> daytimes;
+  int cursor;
+};
+
+#endif
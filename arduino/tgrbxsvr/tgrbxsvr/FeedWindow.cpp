@@ -0,0 +1,89 @@
+#include "FeedWindow.h"
+#include <algorithm>
+
+const long FEED_WINDOW_DAY = 86400000L;  //ms
+
+FeedWindow::FeedWindow()
+  : maxTimes(0), startDaytime(0), minSpacing(0), rollingLimit(0) {
+  reset();
+}
+
+void FeedWindow::configure(int newMaxTimes, long newStartDaytime, long newMinSpacing, int newRollingLimit) {
+  maxTimes = std::min(std::max(newMaxTimes, 0), FEED_WINDOW_HISTORY);
+  startDaytime = ((newStartDaytime % FEED_WINDOW_DAY) + FEED_WINDOW_DAY) % FEED_WINDOW_DAY;
+  minSpacing = std::max(newMinSpacing, 0L);
+  rollingLimit = std::min(std::max(newRollingLimit, 0), FEED_WINDOW_HISTORY);
+  update();
+}
+
+void FeedWindow::reset() {
+  next = 0;
+  count = 0;
+  nextEligible = 0;
+}
+
+void FeedWindow::feedDone(int64_t timestampMS) {
+  feeds[next] = timestampMS;
+  next = (next + 1) % FEED_WINDOW_HISTORY;
+  if (count < FEED_WINDOW_HISTORY) {
+    count++;
+  }
+  update();
+}
+
+void FeedWindow::feedMissed(int64_t timestampMS) {
+  nextEligible = std::max(nextEligible, timestampMS + (int64_t)std::max(minSpacing, FEED_WINDOW_RETRY_TIME));
+}
+
+bool FeedWindow::isEligible(int64_t timestampMS) {
+  return maxTimes > 0 && timestampMS >= nextEligible;
+}
+
+int64_t FeedWindow::getNextEligible() {
+  return nextEligible;
+}
+
+int FeedWindow::getFeedsInPeriod(int64_t timestampMS) {
+  const int64_t periodStart = getPeriodStart(timestampMS);
+  int feedsInPeriod = 0;
+  for (int age = 0; age < count && getFeed(age) >= periodStart; age++) {
+    feedsInPeriod++;
+  }
+  return feedsInPeriod;
+}
+
+//start of the feeding day that contains timestampMS
+int64_t FeedWindow::getPeriodStart(int64_t timestampMS) {
+  const int64_t sinceStart = timestampMS - startDaytime;
+  int64_t day = sinceStart / FEED_WINDOW_DAY;
+  if (sinceStart < 0 && sinceStart % FEED_WINDOW_DAY != 0) {
+    day--;
+  }
+  return day * FEED_WINDOW_DAY + startDaytime;
+}
+
+int64_t FeedWindow::getFeed(int age) {
+  return feeds[(next - 1 - age + 2 * FEED_WINDOW_HISTORY) % FEED_WINDOW_HISTORY];
+}
+
+void FeedWindow::update() {
+  if (count == 0) {
+    nextEligible = 0;
+    return;
+  }
+
+  const int64_t latest = getFeed(0);
+  int64_t eligible = latest + minSpacing;
+
+  //all feeds of this feeding day are used, wait for the next one
+  if (maxTimes > 0 && getFeedsInPeriod(latest) >= maxTimes) {
+    eligible = std::max(eligible, getPeriodStart(latest) + (int64_t)FEED_WINDOW_DAY);
+  }
+
+  //the oldest feed that counts for the rolling limit has to leave the window first
+  if (rollingLimit > 0 && count >= rollingLimit) {
+    eligible = std::max(eligible, getFeed(rollingLimit - 1) + (int64_t)FEED_WINDOW_DAY);
+  }
+
+  nextEligible = eligible;
+}
@@ -0,0 +1,41 @@
+#ifndef FEEDWINDOW_H
+#define FEEDWINDOW_H
+
+#include <stdint.h>
+
+//Eligibility of MaxTimes feeds. Times are unix ms like the loop timestamps (currentTimestamp).
+//  - at most maxTimes feeds per feeding day, the feeding day starts at startDaytime (ms since midnight)
+//  - at least minSpacing ms between two feeds
+//  - optional: at most rollingLimit feeds in any 24 h window (0 = off)
+//The earliest next eligible time is computed once when a feed is done, checking it is O(1).
+const int FEED_WINDOW_HISTORY = 32;        //limits above this are capped
+const long FEED_WINDOW_RETRY_TIME = 60000;  //ms, minimum wait after a skipped or failed feed
+
+class FeedWindow {
+public:
+  FeedWindow();
+  void configure(int maxTimes, long startDaytime, long minSpacing, int rollingLimit);
+  void reset();
+  void feedDone(int64_t timestampMS);
+  void feedMissed(int64_t timestampMS);  //skipped or aborted, not counted but retried later
+  bool isEligible(int64_t timestampMS);
+  int64_t getNextEligible();
+  int getFeedsInPeriod(int64_t timestampMS);
+
+private:
+  void update();
+  int64_t getPeriodStart(int64_t timestampMS);
+  int64_t getFeed(int age);  //0 = latest
+
+  int maxTimes;
+  long startDaytime;
+  long minSpacing;
+  int rollingLimit;
+
+  int64_t feeds[FEED_WINDOW_HISTORY];  //ring buffer of the latest feeds
+  int next;
+  int count;
+  int64_t nextEligible;
+};
+
+#endif
@@ -0,0 +1,35 @@
+#include "FlowController.h"
+#include <Arduino.h>
+
+void FlowController::start() {
+  integral = 1;
+  targetFlow = FLOW_MAX_TARGET;
+  flowing = false;
+}
+
+//returns the opening (0..1), flowRate in gramm/second, positive while dispensing
+double FlowController::update(double remainingMass, double flowRate, double dt) {
+  targetFlow = max(FLOW_MIN_TARGET, min(FLOW_MAX_TARGET, remainingMass / FLOW_THROTTLE_TIME));
+
+  //stay fully open until the food flows, the flow rate is meaningless before
+  if (!flowing) {
+    flowing = flowRate >= FLOW_MIN_TARGET;
+    if (!flowing) {
+      return 1;
+    }
+  }
+
+  const double error = targetFlow - flowRate;
+  const double output = integral + FLOW_KP * error;
+
+  //no integration while saturated (anti windup)
+  if ((output < 1 || error < 0) && (output > FLOW_MIN_OPENING || error > 0)) {
+    integral = max(FLOW_MIN_OPENING, min(1.0, integral + FLOW_KI * error * dt));
+  }
+
+  return max(FLOW_MIN_OPENING, min(1.0, output));
+}
+
+double FlowController::getTargetFlow() {
+  return targetFlow;
+}
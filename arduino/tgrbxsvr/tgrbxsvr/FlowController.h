@@ -0,0 +1,27 @@
+#ifndef FLOWCONTROLLER_H
+#define FLOWCONTROLLER_H
+
+//PI controller for the opening of the container while dispensing.
+//The target flow is high at first and throttled near the target weight,
+//so the predicted shutoff happens at a low, well known flow rate.
+
+const double FLOW_MAX_TARGET = 20;     //gramm/second
+const double FLOW_MIN_TARGET = 3;      //gramm/second
+const double FLOW_THROTTLE_TIME = 1.5; //seconds, the remaining mass should flow in this time
+const double FLOW_KP = 0.02;           //opening per gramm/second
+const double FLOW_KI = 0.03;           //opening per gramm
+const double FLOW_MIN_OPENING = 0.2;   //below the food does not flow reliably
+
+class FlowController {
+public:
+  void start();
+  double update(double remainingMass, double flowRate, double dt);
+  double getTargetFlow();
+
+private:
+  double integral = 1;
+  double targetFlow = FLOW_MAX_TARGET;
+  bool flowing = false;
+};
+
+#endif
@@ -20,6 +20,105 @@ void setJsonStatus(MachineStatus* data, ArduinoJson::JsonObject statusObject) {
   statusObject["SDCardConnection"] = data->SDCardConnection;
   statusObject["AutomaticFeeding"] = data->AutomaticFeeding;
   statusObject["ManualFeeding"] = data->ManualFeeding;
+  statusObject["SampleRate"] = data->SampleRate;
+  statusObject["ContainerFlowRate"] = data->ContainerFlowRate;
+  statusObject["PlateFlowRate"] = data->PlateFlowRate;
+  statusObject["ContainerOpening"] = data->ContainerOpening;
+  statusObject["FeedState"] = data->State;
+  statusObject["FeedTransitions"] = data->FeedTransitions;
+}
+
+void setJsonCalibration(const CalibrationJob& job, ArduinoJson::JsonObject calibrationObject) {
+  calibrationObject["ID"] = job.ID;
+  calibrationObject["Scale"] = job.ScaleID;
+  calibrationObject["State"] = job.State;
+  calibrationObject["Point"] = job.PointCount;
+  calibrationObject["NumPoints"] = job.NumPoints;
+  calibrationObject["Progress"] = (double)job.CollectedReadings / CALIBRATION_READINGS;
+  calibrationObject["ScaleFactor"] = job.ScaleFactor;
+  calibrationObject["Quadratic"] = job.QuadraticFactor;
+}
+
+void setJsonCommandResult(const CommandResult& result, ArduinoJson::JsonObject resultObject) {
+  resultObject["ID"] = result.ID;
+  resultObject["Type"] = result.Type;
+  resultObject["Success"] = result.Success;
+  resultObject["Value"] = result.Value;
+  resultObject["Latency"] = result.Latency;
+}
+
+String serializeCommandMetrics(const CommandMetrics& metrics) {
+  String serialized;
+  ArduinoJson::DynamicJsonDocument doc(1024);
+  ArduinoJson::JsonArray list = doc.createNestedArray("commands");
+
+  for (int type = 0; type < NUM_COMMAND_TYPES; type++) {
+    const CommandLatency& latency = metrics.Latency[type];
+    ArduinoJson::JsonObject latencyObject = list.createNestedObject();
+    latencyObject["Type"] = type;
+    latencyObject["Count"] = latency.Count;
+    latencyObject["Last"] = latency.Last;
+    latencyObject["Max"] = latency.Max;
+    latencyObject["Mean"] = latency.Mean;
+  }
+
+  serializeJson(doc, serialized);
+  return serialized;
+};
+
+String serializeLoopGovernorStats(const LoopGovernorStats& stats) {
+  String serialized;
+  ArduinoJson::DynamicJsonDocument doc(1024);
+  doc["Tier"] = stats.Tier;
+  doc["Demand"] = stats.Demand;
+  ArduinoJson::JsonArray list = doc.createNestedArray("tiers");
+
+  for (int tier = 0; tier < NUM_LOOP_TIERS; tier++) {
+    ArduinoJson::JsonObject tierObject = list.createNestedObject();
+    tierObject["Tier"] = tier;
+    tierObject["Frequency"] = LOOP_TIERS[tier].Frequency;
+    tierObject["Entries"] = stats.Tiers[tier].Entries;
+    tierObject["Time"] = stats.Tiers[tier].Time;
+  }
+
+  serializeJson(doc, serialized);
+  return serialized;
+}
+
+String serializePowerStats(const PowerStats& stats) {
+  String serialized;
+  ArduinoJson::DynamicJsonDocument doc(512);
+  doc["LightSleep"] = stats.LightSleep;
+  doc["Performance"] = stats.Performance;
+  doc["DutyCycle"] = stats.DutyCycle;
+  doc["PerformanceShare"] = stats.PerformanceShare;
+  doc["EstimatedPower"] = stats.EstimatedPower;
+  doc["LastFeedWakeLatency"] = stats.LastFeedWakeLatency;
+  doc["MaxFeedWakeLatency"] = stats.MaxFeedWakeLatency;
+  doc["FeedWakeups"] = stats.FeedWakeups;
+  serializeJson(doc, serialized);
+  return serialized;
+}
+
+//oldest transition first
+String serializeFeedTrace(const FeedTrace& trace) {
+  String serialized;
+  ArduinoJson::DynamicJsonDocument doc(4096);
+  doc["Count"] = trace.Count;
+  ArduinoJson::JsonArray list = doc.createNestedArray("transitions");
+
+  const unsigned long first = trace.Count > FEED_TRACE_LENGTH ? trace.Count - FEED_TRACE_LENGTH : 0;
+  for (unsigned long i = first; i < trace.Count; i++) {
+    const FeedTransition& transition = trace.Entries[i % FEED_TRACE_LENGTH];
+    ArduinoJson::JsonObject transitionObject = list.createNestedObject();
+    transitionObject["From"] = transition.From;
+    transitionObject["To"] = transition.To;
+    transitionObject["Timestamp"] = transition.Timestamp;
+    transitionObject["Dwell"] = transition.Dwell;
+  }
+
+  serializeJson(doc, serialized);
+  return serialized;
 }
 
 String serializeScaleData(ScaleData data) {
@@ -82,6 +181,10 @@ void setJsonSchedule(ArduinoJson::JsonObject scheduleObject, Schedule* schedule)
   scheduleObject["MaxTimes"] = schedule->MaxTimes;
   scheduleObject["MaxTimesStartTime"] = schedule->MaxTimesStartTime;
   scheduleObject["OnlyWhenEmpty"] = schedule->OnlyWhenEmpty;
+  scheduleObject["DispenseMode"] = schedule->DispenseMode;
+  scheduleObject["Rules"] = schedule->Rules;
+  scheduleObject["MinFeedSpacing"] = schedule->MinFeedSpacing;
+  scheduleObject["RollingLimit"] = schedule->RollingLimit;
 }
 
 Schedule* deserializeSchedule(char* data) {
@@ -104,6 +207,10 @@ Schedule* deserializeSchedule(char* data) {
   schedule->MaxTimes = doc["MaxTimes"].as<int>();
   schedule->MaxTimesStartTime = doc["MaxTimesStartTime"].as<long>();
   schedule->OnlyWhenEmpty = doc["OnlyWhenEmpty"].as<bool>();
+  schedule->DispenseMode = doc["DispenseMode"].as<int>();
+  schedule->Rules = doc["Rules"] | "";
+  schedule->MinFeedSpacing = doc["MinFeedSpacing"].as<long>();
+  schedule->RollingLimit = doc["RollingLimit"].as<int>();
   return schedule;
 };
 
@@ -5,10 +5,22 @@
 #include <ArduinoJson.h>
 #include <vector>
 #include "Models.h"
+#include "ScaleCalibration.h"
+#include "FeedStateMachine.h"
+#include "LoopGovernor.h"
+#include "PowerManager.h"
 
 String serializeStatus(MachineStatus data);
 void setJsonStatus(MachineStatus* data, ArduinoJson::JsonObject statusObject);
 
+void setJsonCalibration(const CalibrationJob& job, ArduinoJson::JsonObject calibrationObject);
+
+void setJsonCommandResult(const CommandResult& result, ArduinoJson::JsonObject resultObject);
+String serializeCommandMetrics(const CommandMetrics& metrics);
+String serializeLoopGovernorStats(const LoopGovernorStats& stats);
+String serializePowerStats(const PowerStats& stats);
+String serializeFeedTrace(const FeedTrace& trace);
+
 String serializeScaleData(ScaleData data);
 void setJsonScaleHistory(ScaleData* data, ArduinoJson::JsonObject dataObject);
 
@@ -0,0 +1,53 @@
+#include "LoopGovernor.h"
+#include <math.h>
+
+LoopGovernor::LoopGovernor()
+  : tier(IdleTier), demand(0), lastUpdate(0), stats() {
+  stats.Tier = IdleTier;
+  stats.Tiers[IdleTier].Entries = 1;
+}
+
+LoopTier LoopGovernor::update(int64_t timestampMS, double change, LoopTier minTier) {
+  //a clock step backwards counts as no time
+  const int64_t elapsed = lastUpdate > 0 && timestampMS > lastUpdate ? timestampMS - lastUpdate : 0;
+  lastUpdate = timestampMS;
+  stats.Tiers[tier].Time += elapsed;
+
+  demand *= exp(-(double)elapsed / 1000 / LOOP_DECAY_TIME);
+  const double magnitude = fabs(change);
+  if (magnitude > demand) {
+    demand = magnitude;
+  }
+
+  int next = tier;
+  while (next < NUM_LOOP_TIERS - 1 && demand >= LOOP_TIERS[next + 1].Threshold) {
+    next++;
+  }
+  while (next > IdleTier && demand < LOOP_TIERS[next].Threshold * LOOP_HYSTERESIS) {
+    next--;
+  }
+  if (next < minTier) {
+    next = minTier;
+  }
+
+  if (next != tier) {
+    tier = (LoopTier)next;
+    stats.Tiers[tier].Entries++;
+  }
+  stats.Tier = tier;
+  stats.Demand = demand;
+  publishedStats.write(stats);
+  return tier;
+}
+
+LoopTier LoopGovernor::getTier() {
+  return tier;
+}
+
+double LoopGovernor::getFrequency() {
+  return LOOP_TIERS[tier].Frequency;
+}
+
+LoopGovernorStats LoopGovernor::getStats() {
+  return publishedStats.read();
+}
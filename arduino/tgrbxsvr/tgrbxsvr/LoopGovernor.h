@@ -0,0 +1,63 @@
+#ifndef LOOPGOVERNOR_H
+#define LOOPGOVERNOR_H
+
+#include <stdint.h>
+#include "SeqLock.h"
+
+//Chooses the sampling (and loop) rate from a few tiers. The demand is the largest weight change per second,
+//it follows rises immediately and decays exponentially afterwards, so a short nudge fades out smoothly.
+//A tier is entered when the demand reaches its threshold and left only once the demand falls below
+//LOOP_HYSTERESIS times that threshold. The feeder phase sets a minimum tier (e.g. fast while the container is open).
+
+enum LoopTier {
+  IdleTier,    //nothing moving
+  WatchTier,   //small changes, e.g. a pet sniffing at the plate
+  ActiveTier,  //eating, refilling, waiting for the final portion weight
+  FastTier,    //container open, calibration
+  NUM_LOOP_TIERS
+};
+
+struct LoopTierConfig {
+  double Frequency;  //Hz
+  double Threshold;  //gramm/second of demand to enter the tier
+};
+
+const LoopTierConfig LOOP_TIERS[NUM_LOOP_TIERS] = {
+  { 0.5, 0 },  //IdleTier
+  { 2, 2 },    //WatchTier
+  { 10, 6 },   //ActiveTier
+  { 50, 20 },  //FastTier
+};
+
+const double LOOP_HYSTERESIS = 0.5;  //fraction of the entry threshold to leave a tier
+const double LOOP_DECAY_TIME = 5;    //seconds, time constant of the demand decay
+
+struct LoopTierStats {
+  uint32_t Entries;
+  int64_t Time;  //ms spent in the tier
+};
+
+struct LoopGovernorStats {
+  LoopTier Tier;
+  double Demand;
+  LoopTierStats Tiers[NUM_LOOP_TIERS];
+};
+
+class LoopGovernor {
+public:
+  LoopGovernor();
+  LoopTier update(int64_t timestampMS, double change, LoopTier minTier);  //change in gramm/second
+  LoopTier getTier();
+  double getFrequency();
+
+  LoopGovernorStats getStats();  //any task
+
+private:
+  LoopTier tier;
+  double demand;
+  int64_t lastUpdate;
+  LoopGovernorStats stats;
+  SeqLock<LoopGovernorStats> publishedStats;
+};
+
+#endif
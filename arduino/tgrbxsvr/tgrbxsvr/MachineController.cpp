@@ -1,35 +1,153 @@
 #include "MachineController.h"
-#include <Servo.h>
-#include <HX711.h>
+#include "freertos/FreeRTOS.h"
+#include <freertos/task.h>
+#include <freertos/semphr.h>
 
 const int servoPin = 14;
 const int SERVO_CLOSE_ANGLE = 0;
 const int SERVO_OPEN_ANGLE = 90;
-Servo servo;
 
-const int LOADCELL_TIMES = 10;
+//Trapezoidal motion profile: the servo accelerates to the speed limit of the move within SERVO_RAMP_TIME
+//and brakes in time to stop at the target. A new target keeps the current velocity, so the flow controller
+//can move the target with every loop without restarting the motion from standstill.
+const double SERVO_OPEN_SPEED = 180;   //degree/second
+const double SERVO_CLOSE_SPEED = 360;  //degree/second, fast to keep the close latency low
+const double SERVO_PULSE_SPEED = 600;  //degree/second, about the no-load speed of the servo (0.1 s/60 degree)
+const double SERVO_RAMP_TIME = 0.1;    //seconds from standstill to the speed limit
+const double SERVO_DEADBAND = 1;       //degree, smaller changes of the opening keep the current target
+const unsigned long SERVO_DETACH_DELAY = 500;  //ms at the closed angle until the pulse is switched off
+
+struct ServoMotion {
+  double TargetAngle;
+  double Speed;  //degree/second, limit of the move
+};
+
+ServoMotion servoMotion;
+double servoAngle = 0;
+double servoVelocity = 0;  //degree/second, owned by updateServoMotion
+bool servoResting = true;
+unsigned long servoUpdateTime = 0;
+unsigned long servoRestingSince = 0;
+volatile bool servoAttached = false;
+double containerOpening = 0;
+portMUX_TYPE servoMux = portMUX_INITIALIZER_UNLOCKED;
+
+const int LOADCELL_TIMES = 10;  //used for taring
+
+//Samples per reading and moving average depth, depending on the feeder phase and the rate of the HX711
+struct SamplingProfile {
+  int Samples;
+  int FilterDepth;
+};
+
+const int MAX_FILTER_DEPTH = 8;
+const ScaleRate PHASE_RATES[] = { LowRate, HighRate, LowRate };
+const SamplingProfile SAMPLING_PROFILES[][3] = {
+  //IdlePhase, DispensingPhase, MeasuringPhase
+  { { 10, 4 }, { 1, 2 }, { 10, 8 } },  //LowRate
+  { { 40, 4 }, { 4, 3 }, { 40, 8 } }   //HighRate, noisier so more samples per reading
+};
+
+FeederPhase samplingPhase = IdlePhase;
+volatile FeederPhase requestedPhase = IdlePhase;  //applied by the sampler before its next reading
+SamplingProfile samplingProfile = SAMPLING_PROFILES[LowRate][IdlePhase];
+double sampleRate = 0;
+
+struct ScaleFilter {
+  double Values[MAX_FILTER_DEPTH];
+  int Next;
+  int Count;
+  double LastValue;  //latest unfiltered raw value minus offset
+};
+
+ScaleFilter filter_A;
+ScaleFilter filter_B;
+
+//quadratic calibration term: load = linear + quadratic * linear^2, with linear = value / scale factor
+double quadratic_A = 0;
+double quadratic_B = 0;
+
+//Sampler task, the only reader of the HX711 modules besides taring
+TaskHandle_t samplerTaskHandle = nullptr;
+SemaphoreHandle_t scaleMutex = nullptr;  //guards the HX711 modules, filters and sampling profile
+EventGroupHandle_t samplerEvents = nullptr;
+EventBits_t samplerBit = 0;
+volatile unsigned long sampleInterval = 2000;  //ms between the end of a sample and the next one
+ScaleSample latestSample = { 0, 0, 0, 0, 0, 0 };
+portMUX_TYPE sampleMux = portMUX_INITIALIZER_UNLOCKED;
+
+//RATE pin shared by both HX711 modules, -1 if it is hard wired to GND (10 SPS only).
+//Most HX711 boards tie RATE to GND. For 80 SPS while dispensing, cut that trace on both boards, wire both RATE
+//pins to one free GPIO (e.g. 23) and set it here, the firmware pulls it low for 10 SPS
+const int LOADCELL_RATE_PIN = -1;
 
 //Container
 const int LOADCELL_A_SCK_PIN = 19;
 const int LOADCELL_A_DOUT_PIN = 21;
-HX711 scale_A;
 
 //Plate
 const int LOADCELL_B_SCK_PIN = 5;
 const int LOADCELL_B_DOUT_PIN = 18;
-HX711 scale_B;
 
-double getScaleValue(HX711 scale) {
-  long val = scale.get_units(LOADCELL_TIMES) * 10;
+void resetFilter(ScaleFilter& filter) {
+  filter.Next = 0;
+  filter.Count = 0;
+}
+
+double applyFilter(ScaleFilter& filter, double value) {
+  filter.Values[filter.Next] = value;
+  filter.Next = (filter.Next + 1) % MAX_FILTER_DEPTH;
+  if (filter.Count < MAX_FILTER_DEPTH) {
+    filter.Count++;
+  }
+
+  const int depth = min(filter.Count, samplingProfile.FilterDepth);
+  double sum = 0;
+  for (int i = 1; i <= depth; i++) {
+    sum += filter.Values[(filter.Next - i + MAX_FILTER_DEPTH) % MAX_FILTER_DEPTH];
+  }
+  return sum / depth;
+}
+
+double getScaleValue(ScaleBackend& scale, ScaleFilter& filter, double quadratic) {
+  const unsigned long start = millis();
+  const double value = scale.getValue(samplingProfile.Samples);
+  const unsigned long duration = millis() - start;
+
+  filter.LastValue = value;
+  const double linear = value / scale.getScale();
+  const double filtered = applyFilter(filter, linear + quadratic * linear * linear);
+
+  //both scales are read once per loop, so one reading takes half of the time per filtered value
+  if (duration > 0) {
+    sampleRate = 1000.0 / (2 * duration);
+  }
+
+  long val = filtered * 10;
   double scaleValue = (double)val / 10;
   return scaleValue;
 }
 
+void samplerTask(void* pvParameters) {
+  MachineController* controller = (MachineController*)pvParameters;
+
+  while (true) {
+    controller->sample();
+    //woken early when the interval gets shorter or the sampling phase changes
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(sampleInterval));
+  }
+
+  vTaskDelete(NULL);
+}
+
+MachineController::MachineController()
+  : scale_A(Container), scale_B(Plate) {}
+
 bool MachineController::initControls() {
   Serial.println("Setting up scale A...");
-  scale_A.begin(LOADCELL_A_DOUT_PIN, LOADCELL_A_SCK_PIN);
+  scale_A.begin(LOADCELL_A_DOUT_PIN, LOADCELL_A_SCK_PIN, LOADCELL_RATE_PIN);
 
-  while (!scale_A.is_ready()) {
+  while (!scale_A.isReady()) {
     Serial.println(".");
     delay(2000);
   }
@@ -37,74 +155,279 @@ bool MachineController::initControls() {
   Serial.println("Scale A ready.");
 
   Serial.println("Setting up scale B...");
-  scale_B.begin(LOADCELL_B_DOUT_PIN, LOADCELL_B_SCK_PIN);
+  scale_B.begin(LOADCELL_B_DOUT_PIN, LOADCELL_B_SCK_PIN, LOADCELL_RATE_PIN);
 
-  while (!scale_B.is_ready()) {
+  while (!scale_B.isReady()) {
     Serial.println(".");
     delay(2000);
   }
 
   Serial.println("Scale B ready.");
 
+  scaleMutex = xSemaphoreCreateMutex();
+
   Serial.println("Start servo");
   servo.attach(servoPin);
   servo.write(systemSettings->ContainerAngleClose);
+  servoAttached = true;
+  servoAngle = systemSettings->ContainerAngleClose;
+  servoMotion = { servoAngle, SERVO_OPEN_SPEED };
+  servoRestingSince = millis();
 
   return true;
 }
 
-void MachineController::setContainerScaleCalibration(double scaleFactor, int offset) {
-  scale_A.set_scale(scaleFactor);
-  scale_A.set_offset(offset);
+void MachineController::setContainerScaleCalibration(double scaleFactor, int offset, double quadratic) {
+  scale_A.setScale(scaleFactor);
+  scale_A.setOffset(offset);
+  quadratic_A = quadratic;
 };
 
-void MachineController::setPlateScaleCalibration(double scaleFactor, int offset) {
-  scale_B.set_scale(scaleFactor);
-  scale_B.set_offset(offset);
-};
-
-bool MachineController::calibrateContainerScale(double targetWeight) {
-  scale_A.calibrate_scale(targetWeight, 5);
-  systemSettings->ContainerScale = scale_A.get_scale();
-  return dataAccess.updateSystemSettings(systemSettings);
+void MachineController::setPlateScaleCalibration(double scaleFactor, int offset, double quadratic) {
+  scale_B.setScale(scaleFactor);
+  scale_B.setOffset(offset);
+  quadratic_B = quadratic;
 };
 
-bool MachineController::calibratePlateScale(double targetWeight) {
-  scale_B.calibrate_scale(targetWeight, 5);
-  systemSettings->PlateScale = scale_B.get_scale();
+bool MachineController::storeScaleCalibration(Scale scale, double scaleFactor, double quadratic) {
+  xSemaphoreTake(scaleMutex, portMAX_DELAY);
+  if (scale == Container) {
+    scale_A.setScale(scaleFactor);
+    quadratic_A = quadratic;
+    systemSettings->ContainerScale = scaleFactor;
+    systemSettings->ContainerScaleQuadratic = quadratic;
+  } else {
+    scale_B.setScale(scaleFactor);
+    quadratic_B = quadratic;
+    systemSettings->PlateScale = scaleFactor;
+    systemSettings->PlateScaleQuadratic = quadratic;
+  }
+  xSemaphoreGive(scaleMutex);
   return dataAccess.updateSystemSettings(systemSettings);
 };
 
 bool MachineController::tareContainerScale() {
+  xSemaphoreTake(scaleMutex, portMAX_DELAY);
   scale_A.tare(LOADCELL_TIMES);
-  systemSettings->ContainerOffset = scale_A.get_offset();
+  systemSettings->ContainerOffset = scale_A.getOffset();
+  xSemaphoreGive(scaleMutex);
   return dataAccess.updateSystemSettings(systemSettings);
 };
 
 bool MachineController::tarePlateScale() {
+  xSemaphoreTake(scaleMutex, portMAX_DELAY);
   scale_B.tare(LOADCELL_TIMES);
-  systemSettings->PlateOffset = scale_B.get_offset();
+  systemSettings->PlateOffset = scale_B.getOffset();
+  xSemaphoreGive(scaleMutex);
   return dataAccess.updateSystemSettings(systemSettings);
 };
 
-bool MachineController::tarePlateScaleWithPlate() {
-  const double currentWeight = getScaleValue(scale_B);
-  userSettings->PlateTAR = currentWeight;
-  return dataAccess.updateUserSettings(userSettings);
-};
-
 double MachineController::getContainerLoad() {
-  return getScaleValue(scale_A);
+  return getScaleValue(scale_A, filter_A, quadratic_A);
 };
 
 double MachineController::getPlateLoad() {
-  return getScaleValue(scale_B) - userSettings->PlateTAR;
+  double plateTAR = 0;
+  {
+    SnapshotGuard<UserSettings> settings(userSettingsSnapshot, SamplerReader);
+    if (settings.get() != nullptr) {
+      plateTAR = settings->PlateTAR;
+    }
+  }
+  return getScaleValue(scale_B, filter_B, quadratic_B) - plateTAR;
 };
 
 void MachineController::openContainer() {
-  servo.write(systemSettings->ContainerAngleClose + systemSettings->ContainerAngleOpen);
+  setContainerOpening(1);
+};
+
+//a short pulse has to open the flap fully, the flap moves at full servo speed
+void MachineController::pulseOpenContainer() {
+  containerOpening = 1;
+  moveServo(systemSettings->ContainerAngleClose + systemSettings->ContainerAngleOpen, SERVO_PULSE_SPEED);
 };
 
 void MachineController::closeContainer() {
-  servo.write(systemSettings->ContainerAngleClose);
+  containerOpening = 0;
+  moveServo(systemSettings->ContainerAngleClose, SERVO_CLOSE_SPEED);
+};
+
+//0 = closed, 1 = fully open
+void MachineController::setContainerOpening(double opening) {
+  containerOpening = max(0.0, min(1.0, opening));
+  const double target = systemSettings->ContainerAngleClose + containerOpening * systemSettings->ContainerAngleOpen;
+  const double speed = target < servoAngle ? SERVO_CLOSE_SPEED : SERVO_OPEN_SPEED;
+  portENTER_CRITICAL(&servoMux);
+  const bool small = abs(target - servoMotion.TargetAngle) < SERVO_DEADBAND && speed == servoMotion.Speed;
+  portEXIT_CRITICAL(&servoMux);
+  if (!small) {
+    moveServo(target, speed);
+  }
+};
+
+double MachineController::getContainerOpening() {
+  return containerOpening;
+};
+
+//seconds a pulse needs to open the closed flap fully
+double MachineController::getPulseOpenTime() {
+  const double distance = systemSettings->ContainerAngleOpen;
+  const double acceleration = SERVO_PULSE_SPEED / SERVO_RAMP_TIME;
+  //the flap reaches full speed only if the distance allows ramping up and down again
+  if (distance >= SERVO_PULSE_SPEED * SERVO_RAMP_TIME) {
+    return distance / SERVO_PULSE_SPEED + SERVO_RAMP_TIME;
+  }
+  return 2 * sqrt(distance / acceleration);
+};
+
+void MachineController::moveServo(double targetAngle, double speed) {
+  portENTER_CRITICAL(&servoMux);
+  servoMotion.TargetAngle = targetAngle;
+  servoMotion.Speed = speed;
+  portEXIT_CRITICAL(&servoMux);
+};
+
+//The closed flap holds itself, so the servo is detached there after SERVO_DETACH_DELAY. Without the pulse,
+//no LEDC channel has to keep running and the CPU may enter light sleep. Any other angle keeps the pulse
+bool MachineController::isServoAttached() {
+  return servoAttached;
+};
+
+//moves the servo one step along the current motion, returns false when the target is reached
+//and the servo is detached if it rests closed. Called periodically by the MotorSupervisor, which owns the servo
+bool MachineController::updateServoMotion() {
+  portENTER_CRITICAL(&servoMux);
+  const ServoMotion motion = servoMotion;
+  portEXIT_CRITICAL(&servoMux);
+
+  const unsigned long now = millis();
+  const bool closed = motion.TargetAngle == systemSettings->ContainerAngleClose;
+  if (servoResting && servoAngle == motion.TargetAngle) {
+    if (servoAttached && closed && now - servoRestingSince >= SERVO_DETACH_DELAY) {
+      servo.detach();
+      servoAttached = false;
+    }
+    return servoAttached && closed;
+  }
+
+  if (!servoAttached) {
+    servo.attach(servoPin);
+    servo.write(round(servoAngle));
+    servoAttached = true;
+  }
+
+  //a motion from standstill starts with this call, the time spent resting does not count
+  const double dt = servoResting ? 0 : (double)(now - servoUpdateTime) / 1000;
+  servoUpdateTime = now;
+
+  const double acceleration = motion.Speed / SERVO_RAMP_TIME;
+  const double distance = motion.TargetAngle - servoAngle;
+  //the fastest velocity that can still brake to a stop at the target
+  const double stopSpeed = min(motion.Speed, sqrt(2 * acceleration * abs(distance)));
+  const double velocityChange = (distance < 0 ? -stopSpeed : stopSpeed) - servoVelocity;
+  servoVelocity += max(-acceleration * dt, min(acceleration * dt, velocityChange));
+
+  double angle = servoAngle + servoVelocity * dt;
+  //arrived, or passed the target within the last step
+  if (distance == 0 || (distance > 0) != (motion.TargetAngle - angle > 0)) {
+    angle = motion.TargetAngle;
+    servoVelocity = 0;
+  }
+
+  if (round(angle) != round(servoAngle) || angle == motion.TargetAngle) {
+    servo.write(round(angle));
+  }
+  portENTER_CRITICAL(&servoMux);
+  servoAngle = angle;
+  portEXIT_CRITICAL(&servoMux);
+  servoResting = angle == motion.TargetAngle;
+  if (servoResting) {
+    servoRestingSince = now;
+  }
+  return !servoResting || closed;
+};
+
+//the new phase is applied by the sampler, so a running reading is not disturbed
+void MachineController::setSamplingPhase(FeederPhase phase) {
+  if (phase == requestedPhase) {
+    return;
+  }
+
+  requestedPhase = phase;
+  if (samplerTaskHandle != nullptr) {
+    xTaskNotifyGive(samplerTaskHandle);
+  }
+};
+
+FeederPhase MachineController::getSamplingPhase() {
+  return requestedPhase;
+};
+
+void MachineController::applySamplingPhase() {
+  const FeederPhase phase = requestedPhase;
+  if (phase == samplingPhase) {
+    return;
+  }
+
+  samplingPhase = phase;
+  scale_A.setRate(PHASE_RATES[phase]);
+  scale_B.setRate(PHASE_RATES[phase]);
+  //the rate stays low if the RATE pin is hard wired
+  samplingProfile = SAMPLING_PROFILES[scale_A.getRate()][phase];
+  //old readings were taken with a different profile and would smear the new one
+  resetFilter(filter_A);
+  resetFilter(filter_B);
+};
+
+double MachineController::getSampleRate() {
+  return sampleRate;
+};
+
+int MachineController::getFilterDepth() {
+  return samplingProfile.FilterDepth;
+};
+
+//starts the sampler task, which sets sampleBit in events whenever a new sample is published.
+//It runs above the loop but blocks while a conversion is pending, see HX711Scale
+bool MachineController::startSampler(EventGroupHandle_t events, EventBits_t sampleBit) {
+  samplerEvents = events;
+  samplerBit = sampleBit;
+  return xTaskCreatePinnedToCore(samplerTask, "Sampler", 4096, this, 2, &samplerTaskHandle, 1) == pdPASS;
+};
+
+void MachineController::setSampleInterval(unsigned long interval) {
+  const unsigned long previous = sampleInterval;
+  sampleInterval = interval;
+  if (interval < previous && samplerTaskHandle != nullptr) {
+    xTaskNotifyGive(samplerTaskHandle);
+  }
+};
+
+ScaleSample MachineController::getLatestSample() {
+  portENTER_CRITICAL(&sampleMux);
+  const ScaleSample sample = latestSample;
+  portEXIT_CRITICAL(&sampleMux);
+  return sample;
+};
+
+//reads both scales and publishes the result, called by the sampler task
+void MachineController::sample() {
+  ScaleSample sample;
+  xSemaphoreTake(scaleMutex, portMAX_DELAY);
+  applySamplingPhase();
+  sample.ContainerLoad = getContainerLoad();
+  sample.PlateLoad = getPlateLoad();
+  sample.ContainerValue = filter_A.LastValue;
+  sample.PlateValue = filter_B.LastValue;
+  sample.SampleRate = sampleRate;
+  xSemaphoreGive(scaleMutex);
+
+  portENTER_CRITICAL(&sampleMux);
+  sample.Sequence = latestSample.Sequence + 1;
+  latestSample = sample;
+  portEXIT_CRITICAL(&sampleMux);
+
+  if (samplerEvents != nullptr) {
+    xEventGroupSetBits(samplerEvents, samplerBit);
+  }
 };
\ No newline at end of file
@@ -1,28 +1,53 @@
 #ifndef MACHINECONTROLLER_H
 #define MACHINECONTROLLER_H
 
+#include "freertos/FreeRTOS.h"
+#include <freertos/event_groups.h>
 #include "Models.h"
 #include "DataAccess.h"
+#include "Backends.h"
+#include "Snapshot.h"
 
 extern DataAccess dataAccess;
 
 extern SystemSettings* systemSettings;
-extern UserSettings* userSettings;
+extern Snapshot<UserSettings> userSettingsSnapshot;
 
 class MachineController {
   public:
+    MachineController();
     bool initControls();
-    void setContainerScaleCalibration(double scaleFactor, int offset );
-    void setPlateScaleCalibration(double scaleFactor, int offset );
-    bool calibrateContainerScale(double targetWeight);
-    bool calibratePlateScale(double targetWeight);
+    void setContainerScaleCalibration(double scaleFactor, int offset, double quadratic);
+    void setPlateScaleCalibration(double scaleFactor, int offset, double quadratic);
+    bool storeScaleCalibration(Scale scale, double scaleFactor, double quadratic);
     bool tareContainerScale();
     bool tarePlateScale();
-    bool tarePlateScaleWithPlate();
     double getContainerLoad();
     double getPlateLoad();
     void openContainer();
+    void pulseOpenContainer();
     void closeContainer();
+    void setContainerOpening(double opening);
+    double getContainerOpening();
+    double getPulseOpenTime();
+    bool updateServoMotion();
+    bool isServoAttached();  //any task
+    void setSamplingPhase(FeederPhase phase);
+    FeederPhase getSamplingPhase();
+    double getSampleRate();
+    int getFilterDepth();
+    bool startSampler(EventGroupHandle_t events, EventBits_t sampleBit);
+    void setSampleInterval(unsigned long interval);
+    ScaleSample getLatestSample();
+    void sample();
+
+  private:
+    void moveServo(double targetAngle, double speed);
+    void applySamplingPhase();
+
+    ScaleBackend scale_A;  //Container
+    ScaleBackend scale_B;  //Plate
+    ActuatorBackend servo;
 }; 
 
 #endif
\ No newline at end of file
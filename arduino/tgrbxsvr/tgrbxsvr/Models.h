@@ -4,6 +4,16 @@
 #include <Arduino.h>
 #include <vector>
 
+enum FeedState {
+  FeedIdle,
+  FeedOpening,     //container commanded open, no flow yet
+  FeedDispensing,  //food flows
+  FeedClosing,     //container commanded closed, food still falling
+  FeedSettling,    //waiting for the final portion weight
+  FeedAborted,     //motor failure, container closed
+  NUM_FEED_STATES
+};
+
 struct MachineStatus {
   double ContainerLoad;
   double PlateLoad;
@@ -13,10 +23,23 @@ struct MachineStatus {
   bool WiFiConnection;
   bool AutomaticFeeding;
   bool ManualFeeding;
+  double SampleRate;  //filtered readings per second
+  double ContainerFlowRate;  //gramm/second
+  double PlateFlowRate;      //gramm/second
+  double ContainerOpening;   //0 = closed, 1 = fully open
+  FeedState State;           //feed state machine
+  unsigned long FeedTransitions;
 };
 
-struct MotorCheckParams {
-  double ContainerLoad;
+enum FeederPhase {
+  IdlePhase,         //nothing moving, deep filtering for precise values
+  DispensingPhase,   //container open, shallow filtering for low latency
+  MeasuringPhase     //container closed, waiting for the final portion weight
+};
+
+enum ScaleRate {
+  LowRate,   //10 SPS, low noise
+  HighRate   //80 SPS, fast
 };
 
 enum SignificantWeightChange {
@@ -42,6 +65,9 @@ struct SystemSettings {
   int PlateOffset;
   int ContainerAngleClose;
   int ContainerAngleOpen;
+  double ContainerScaleQuadratic;
+  double PlateScaleQuadratic;
+  double ContainerCloseLatency;  //seconds, learned from past feeds
 };
 
 //--- DB: History ---
@@ -54,7 +80,8 @@ enum EventType { Feed,
                  WiFiConnectionReturned,
                  SDConnectionLost,
                  SDConnectionReturned,
-                 SkippedFeed
+                 SkippedFeed,
+                 ContainerJam
 };
 
 struct Event {
@@ -75,11 +102,37 @@ struct ScaleData {
   double Value;
 };
 
+//latest filtered readings of both scales, published by the sampler task
+struct ScaleSample {
+  double ContainerLoad;
+  double PlateLoad;
+  double ContainerValue;  //latest unfiltered raw value minus offset, for the calibration
+  double PlateValue;
+  double SampleRate;
+  unsigned long Sequence;  //increments with every new sample
+};
+
+struct FeedResult {
+  int ID;
+  long CreatedOn;
+  double Requested;     //gramm
+  double Dispensed;     //gramm
+  double Overshoot;     //gramm, dispensed - requested
+  double FlowRate;      //gramm/second when the container was closed
+  double CloseLatency;  //seconds, learned value after this feed
+};
+
 //--- DB: User ---
 
 enum ScheduleMode {
   FixedDaytime,
-  MaxTimes
+  MaxTimes,
+  Calendar  //weekday rules with date ranges and exceptions, see CalendarSchedule.h
+};
+
+enum DispenseStrategy {
+  ContinuousDispense,
+  PulseDispense  //short pulses for small portions
 };
 
 struct Schedule {  //also for history
@@ -91,8 +144,12 @@ struct Schedule {  //also for history
   bool Active;
   std::vector<long> Daytimes;
   int MaxTimes;
-  long MaxTimesStartTime;
+  long MaxTimesStartTime;  //daytime in ms, the MaxTimes feeding day starts here
+  long MinFeedSpacing;     //ms between two MaxTimes feeds
+  int RollingLimit;        //max. MaxTimes feeds in any 24 h, 0 = off
   bool OnlyWhenEmpty;
+  int DispenseMode;
+  String Rules;  //compact calendar rules for Calendar mode
 };
 
 struct Notification {
@@ -117,4 +174,54 @@ struct UserSettings {
   int Theme;
 };
 
+enum CommandType {
+  ContainerCommand,          //Open: open or close the container manually
+  ScheduleCommand,           //NewSchedule: new selected schedule, nullptr = none
+  UserSettingsCommand,       //NewUserSettings
+  ContainerAngleCommand,     //Open, Angle: set and move to the open or close angle
+  TareCommand,               //ScaleID
+  PlateTareCommand,          //use the current plate load as plate tar
+  CalibrationCommand,        //ScaleID, Weight, Points, Quadratic: start a calibration job
+  CalibrationPointCommand,   //JobID, Weight: next reference weight of a calibration job
+  CalibrationCancelCommand,  //JobID: abandon a calibration job
+  NUM_COMMAND_TYPES
+};
+
+//request from the network task to the control loop, the pointers are handed over to the loop
+struct Command {
+  int ID;
+  CommandType Type;
+  unsigned long EnqueuedAt;  //micros
+  bool Open;
+  int Angle;
+  Scale ScaleID;
+  double Weight;
+  int Points;
+  bool Quadratic;
+  int JobID;
+  Schedule* NewSchedule;
+  UserSettings* NewUserSettings;
+};
+
+//sent to the websocket clients after a command was executed
+struct CommandResult {
+  int ID;
+  CommandType Type;
+  bool Success;
+  int Value;              //e.g. the ID of a started calibration job
+  unsigned long Latency;  //micros from enqueue to execution
+};
+
+//enqueue to execution latency per command type, in micros
+struct CommandLatency {
+  unsigned long Count;
+  unsigned long Last;
+  unsigned long Max;
+  double Mean;
+};
+
+struct CommandMetrics {
+  CommandLatency Latency[NUM_COMMAND_TYPES];
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,253 @@
+#include "MotorSupervisor.h"
+#include <freertos/task.h>
+
+extern MachineController machineController;
+
+//fast close/open moves to shake the food loose
+const WiggleStep WIGGLE_SEQUENCE[] = {
+  { 0, 150 },
+  { 1, 150 },
+  { 0, 150 },
+  { 1, 150 },
+  { 0, 150 },
+  { 1, 300 }
+};
+const int WIGGLE_STEPS = sizeof(WIGGLE_SEQUENCE) / sizeof(WiggleStep);
+
+void motorSupervisorTask(void* pvParameters) {
+  MotorSupervisor* supervisor = (MotorSupervisor*)pvParameters;
+  supervisor->run();
+}
+
+bool MotorSupervisor::init() {
+  if (taskHandle != nullptr) {
+    return true;
+  }
+
+  queue = xQueueCreate(MOTOR_QUEUE_LENGTH, sizeof(MotorCommand));
+  if (queue == nullptr) {
+    Serial.println("Couldn't create motor queue");
+    return false;
+  }
+
+  return xTaskCreatePinnedToCore(motorSupervisorTask, "MotorSupervisor", 3072, this, 2, &taskHandle, 1) == pdPASS;
+}
+
+void MotorSupervisor::open(bool check) {
+  closeChecking = false;
+  send({ MotorOpen, 1, check });
+}
+
+void MotorSupervisor::pulseOpen() {
+  closeChecking = false;
+  send({ MotorPulseOpen, 1, false });
+}
+
+void MotorSupervisor::close(bool check) {
+  closeChecking = check;
+  send({ MotorClose, 0, check });
+}
+
+void MotorSupervisor::setOpening(double opening) {
+  send({ MotorSetOpening, opening, false });
+}
+
+//latest readings of the control loop
+void MotorSupervisor::updateLoad(double load, double rate) {
+  portENTER_CRITICAL(&loadMux);
+  containerLoad = load;
+  flowRate = rate;
+  portEXIT_CRITICAL(&loadMux);
+}
+
+bool MotorSupervisor::getMotorOperation() {
+  return motorOperation;
+}
+
+bool MotorSupervisor::isCloseChecking() {
+  return closeChecking;
+}
+
+int MotorSupervisor::getJamCount() {
+  return jamCount;
+}
+
+void MotorSupervisor::reportFailure() {
+  motorOperation = false;
+}
+
+void MotorSupervisor::resetMotorOperation() {
+  motorOperation = true;
+}
+
+void MotorSupervisor::send(MotorCommand command) {
+  if (xQueueSend(queue, &command, 0) != pdTRUE) {
+    Serial.println("Motor queue full, command dropped");
+  }
+}
+
+void MotorSupervisor::run() {
+  while (true) {
+    step();
+  }
+}
+
+//one pass of the task, the host build calls it every MOTOR_TICK_INTERVAL instead of running the task
+void MotorSupervisor::step() {
+  MotorCommand command;
+
+  //sleep until the next command, unless the servo moves or a check is running
+  const TickType_t wait = moving || check != NoCheck ? pdMS_TO_TICKS(MOTOR_TICK_INTERVAL) : portMAX_DELAY;
+  if (xQueueReceive(queue, &command, wait) == pdTRUE) {
+    handleCommand(command);
+  }
+
+  moving = machineController.updateServoMotion();
+  checkTrajectory();
+}
+
+void MotorSupervisor::handleCommand(const MotorCommand& command) {
+  if (command.Type == MotorSetOpening) {
+    lastOpening = command.Opening;
+    //the wiggle sequence restores the opening when it is done
+    if (check != Unjamming) {
+      machineController.setContainerOpening(command.Opening);
+      moving = true;
+    }
+    return;
+  }
+
+  portENTER_CRITICAL(&loadMux);
+  const double load = containerLoad;
+  portEXIT_CRITICAL(&loadMux);
+
+  if (command.Type == MotorOpen || command.Type == MotorPulseOpen) {
+    lastOpening = 1;
+    unjamRetries = 0;
+    if (command.Type == MotorPulseOpen) {
+      machineController.pulseOpenContainer();
+    } else {
+      machineController.openContainer();
+    }
+    check = NoCheck;
+    if (command.Check) {
+      startOpenCheck(load);
+    }
+  } else {
+    lastOpening = 0;
+    machineController.closeContainer();
+    check = command.Check ? CloseSettle : NoCheck;
+    checkDeadline = millis() + MOTOR_CLOSE_CHECK_WAIT * 1000;
+  }
+  moving = true;
+}
+
+void MotorSupervisor::startOpenCheck(double load) {
+  check = OpenCheck;
+  checkStartLoad = load;
+  checkDeadline = millis() + JAM_START_TIME;
+}
+
+void MotorSupervisor::checkTrajectory() {
+  if (check == NoCheck) {
+    return;
+  }
+
+  portENTER_CRITICAL(&loadMux);
+  const double load = containerLoad;
+  const double rate = flowRate;
+  portEXIT_CRITICAL(&loadMux);
+  const unsigned long now = millis();
+  const bool timeUp = (long)(now - checkDeadline) >= 0;
+
+  switch (check) {
+    case OpenCheck:
+      if (checkStartLoad - load >= MOTOR_CHECK_MIN_DROP || rate <= -MOTOR_CHECK_FLOW) {
+        motorOperation = true;
+        check = FlowMonitor;
+        progressLoad = load;
+        progressTime = now;
+      } else if (timeUp) {
+        Serial.println("Motor check: no flow after opening");
+        handleJam(load);
+      }
+      break;
+    case FlowMonitor:
+      if (load <= progressLoad - JAM_MIN_PROGRESS) {
+        progressLoad = load;
+        progressTime = now;
+      } else if (load <= JAM_EMPTY_LOAD) {
+        //running empty is not a jam, the feed logic handles it
+        check = NoCheck;
+      } else if (lastOpening > 0 && now - progressTime > JAM_DETECT_TIME) {
+        Serial.println("Motor check: flow stalled");
+        handleJam(load);
+      }
+      break;
+    case Unjamming:
+      updateUnjam(load);
+      break;
+    //the flow rate still spans the fast readings before closing, only loads read after closing are compared
+    case CloseSettle:
+      if (timeUp) {
+        check = CloseCheck;
+        checkStartLoad = load;
+        checkDeadline = now + MOTOR_CLOSE_CHECK_WAIT * 1000;
+      }
+      break;
+    case CloseCheck:
+      if (timeUp) {
+        //food still flowing long after closing
+        if (checkStartLoad - load >= MOTOR_CHECK_MIN_DROP) {
+          Serial.println("Motor check: container did not close");
+          motorOperation = false;
+        } else {
+          motorOperation = true;
+        }
+        check = NoCheck;
+        closeChecking = false;
+      }
+      break;
+    case NoCheck:
+      break;
+  }
+}
+
+void MotorSupervisor::handleJam(double load) {
+  jamCount++;
+
+  if (unjamRetries >= UNJAM_MAX_RETRIES) {
+    Serial.println("Unjam failed");
+    motorOperation = false;
+    check = NoCheck;
+    return;
+  }
+
+  unjamRetries++;
+  Serial.print("Unjam attempt ");
+  Serial.println(unjamRetries);
+  check = Unjamming;
+  wiggleStep = -1;
+  wiggleStepEnd = millis();
+  updateUnjam(load);
+}
+
+void MotorSupervisor::updateUnjam(double load) {
+  const unsigned long now = millis();
+  if ((long)(now - wiggleStepEnd) < 0) {
+    return;
+  }
+
+  wiggleStep++;
+  if (wiggleStep >= WIGGLE_STEPS) {
+    //back to the requested opening and watch again
+    machineController.setContainerOpening(lastOpening);
+    moving = true;
+    startOpenCheck(load);
+    return;
+  }
+
+  machineController.setContainerOpening(WIGGLE_SEQUENCE[wiggleStep].Opening);
+  moving = true;
+  wiggleStepEnd = now + WIGGLE_SEQUENCE[wiggleStep].Duration;
+}
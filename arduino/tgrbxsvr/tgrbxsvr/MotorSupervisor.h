@@ -0,0 +1,96 @@
+#ifndef MOTORSUPERVISOR_H
+#define MOTORSUPERVISOR_H
+
+#include "freertos/FreeRTOS.h"
+#include <freertos/queue.h>
+#include "MachineController.h"
+
+//One long lived task owning the container servo. Open/close commands arrive through a queue,
+//the task moves the servo along its motion profile and checks that the container load
+//follows the expected trajectory (food flows after opening, keeps flowing while open, stops after closing).
+//A stalled flow while open is treated as a jam and the flap is wiggled free before giving up.
+
+const double MOTOR_CHECK_WAIT = 2;      //seconds until a missing weight change counts as failure
+const double MOTOR_CHECK_MIN_DROP = 2;  //gramm, container load drop that proves the flap opened
+const double MOTOR_CHECK_FLOW = 2;      //gramm/second, flow that still counts as "flowing"
+const double MOTOR_CLOSE_CHECK_WAIT = 3;  //seconds per close check stage, longer than one measuring reading
+const int MOTOR_TICK_INTERVAL = 10;     //ms, while moving or checking
+const long JAM_START_TIME = 1200;       //ms after opening until food has to flow
+const long JAM_DETECT_TIME = 400;       //ms without progress until the flow counts as stalled
+const double JAM_MIN_PROGRESS = 0.5;    //gramm, container load drop that counts as progress
+const double JAM_EMPTY_LOAD = 5;        //gramm, no jam detection for an (almost) empty container
+const int UNJAM_MAX_RETRIES = 2;
+const int MOTOR_QUEUE_LENGTH = 8;
+
+enum MotorCommandType {
+  MotorOpen,
+  MotorPulseOpen,  //opens at full servo speed for a short pulse
+  MotorClose,
+  MotorSetOpening
+};
+
+struct MotorCommand {
+  MotorCommandType Type;
+  double Opening;
+  bool Check;  //supervise the weight trajectory after this command
+};
+
+enum MotorCheck {
+  NoCheck,
+  OpenCheck,    //waiting for the food to flow
+  FlowMonitor,  //food flows, watching for a stall
+  Unjamming,    //running the wiggle sequence
+  CloseSettle,  //food in flight lands, the first reading after closing arrives
+  CloseCheck    //the load has to stay put
+};
+
+struct WiggleStep {
+  double Opening;
+  long Duration;  //ms
+};
+
+class MotorSupervisor {
+public:
+  bool init();
+  void open(bool check);
+  void pulseOpen();
+  void close(bool check);
+  void setOpening(double opening);
+  void updateLoad(double containerLoad, double flowRate);
+  bool getMotorOperation();
+  bool isCloseChecking();  //any task
+  int getJamCount();
+  void reportFailure();
+  void resetMotorOperation();
+  void run();
+  void step();
+
+private:
+  void send(MotorCommand command);
+  void handleCommand(const MotorCommand& command);
+  void checkTrajectory();
+  void startOpenCheck(double load);
+  void handleJam(double load);
+  void updateUnjam(double load);
+
+  QueueHandle_t queue = nullptr;
+  TaskHandle_t taskHandle = nullptr;
+  portMUX_TYPE loadMux = portMUX_INITIALIZER_UNLOCKED;
+  double containerLoad = 0;
+  double flowRate = 0;
+  volatile bool motorOperation = true;
+  volatile bool closeChecking = false;  //set by close() already, the command may still be queued
+  MotorCheck check = NoCheck;
+  double checkStartLoad = 0;
+  unsigned long checkDeadline = 0;
+  bool moving = true;  //until the servo attached at startup is detached
+  double lastOpening = 0;
+  double progressLoad = 0;
+  unsigned long progressTime = 0;
+  int unjamRetries = 0;
+  int wiggleStep = 0;
+  unsigned long wiggleStepEnd = 0;
+  volatile int jamCount = 0;
+};
+
+#endif
@@ -1,40 +1,137 @@
 #include <string>
 #include <vector>
+#include <atomic>
 #include "NetworkController.h"
 #include "freertos/FreeRTOS.h"
 #include <freertos/task.h>
 #include <freertos/projdefs.h>
 #include <WiFi.h>
-#include <WiFiUdp.h>
 #include <AsyncTCP.h>
 #include "AsyncJson.h"
 #include <ESPAsyncWebServer.h>
-#include <NTPClient.h>
 #include <ESPmDNS.h>
 #include <ArduinoJson.h>
 #include <SD.h>
 #include "JsonHelper.h"
+#include "SpscQueue.h"
 
 const String frontendRootPath = "/frontend/";
 
-WiFiUDP ntpUdp;
-NTPClient ntpClient(ntpUdp);
-long startUpTimestamp = 0;
-long startUpDaytimeMS = 0;
-int today = 0;
-
 AsyncWebServer server(80);
 AsyncWebSocket ws("/ws");
 
+//Broadcaster task on the network core, the control loop only fills the queues
+const int NETWORK_CORE = 0;
+const int STATUS_QUEUE_LENGTH = 4;
+const int EVENT_QUEUE_LENGTH = 32;
+SpscQueue<StatusMessage, STATUS_QUEUE_LENGTH> statusQueue;
+SpscQueue<Event, EVENT_QUEUE_LENGTH> eventQueue;
+SpscQueue<CommandResult, EVENT_QUEUE_LENGTH> commandResultQueue;
+TaskHandle_t broadcasterTaskHandle = nullptr;
+
+//A frame carries the latest status, the calibration job and up to FRAME_MAX_ITEMS events and command results,
+//more are sent in further frames. Keys are string literals and not copied, the capacity only counts the slots
+const int FRAME_MAX_ITEMS = 8;
+const size_t FRAME_CAPACITY = JSON_OBJECT_SIZE(4)                                                 //status, history, calibration, commands
+                              + JSON_OBJECT_SIZE(13)                                              //status
+                              + JSON_OBJECT_SIZE(3) + JSON_ARRAY_SIZE(FRAME_MAX_ITEMS)            //history, events
+                              + FRAME_MAX_ITEMS * JSON_OBJECT_SIZE(2)                             //event
+                              + JSON_OBJECT_SIZE(8)                                               //calibration
+                              + JSON_ARRAY_SIZE(FRAME_MAX_ITEMS) + FRAME_MAX_ITEMS * JSON_OBJECT_SIZE(5);  //command results
+const size_t FRAME_LENGTH = 3072;  //about 2 kB in the worst case, every double printed with all digits
+
+//status json, kept static to avoid heap use
+ArduinoJson::StaticJsonDocument<FRAME_CAPACITY> statusDoc;
+char serializedStatus[FRAME_LENGTH];
+
+//The timer only flags the cleanup, the broadcaster runs it next to its textAll calls, the timer task never touches
+//the websocket. The AsyncTCP task still handles the client events at the same time, AsyncWebSocket guards
+//its client list for that with its own lock
 const int CLEAN_CLIENTS_INTERVAL = 10;  //seconds
-TaskHandle_t clearClientsTaskHandle;
+std::atomic<bool> cleanupClientsDue(false);
+std::atomic<int> webClientCount(0);  //kept by the websocket events, other tasks read it instead of ws.count()
+
+//timer worker
+void cleanupClientsTimeout(void *arg) {
+  cleanupClientsDue = true;
+  xTaskNotifyGive(broadcasterTaskHandle);
+}
+
+//only the latest status is sent, events, command results and calibration updates are never skipped
+void broadcasterTask(void *pvParameters) {
+  NetworkController *controller = (NetworkController *)pvParameters;
+  StatusMessage message;
+  StatusMessage latest;
+  CalibrationJob calibration;
 
-void clearClientsTask(void *pvParameters) {
   while (true) {
-    //Serial.println("Cleanup clients");
-    vTaskDelay(pdMS_TO_TICKS(CLEAN_CLIENTS_INTERVAL * 1000));
-    ws.cleanupClients();
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    if (cleanupClientsDue.exchange(false)) {
+      ws.cleanupClients();
+    }
+
+    bool hasStatus = false;
+    bool hasCalibration = false;
+    while (statusQueue.pop(message)) {
+      latest = message;
+      hasStatus = true;
+      if (message.HasCalibration) {
+        calibration = message.Calibration;
+        hasCalibration = true;
+      }
+    }
+
+    statusDoc.clear();
+    ArduinoJson::JsonObject status = statusDoc.createNestedObject("status");
+    if (hasStatus) {
+      setJsonStatus(&latest.Status, status);
+    }
+    ArduinoJson::JsonObject history = statusDoc.createNestedObject("history");
+    history.createNestedArray("schedules");
+    ArduinoJson::JsonArray events = history.createNestedArray("events");
+    history.createNestedArray("scaleData");
+
+    if (hasCalibration) {
+      ArduinoJson::JsonObject calibrationObject = statusDoc.createNestedObject("calibration");
+      setJsonCalibration(calibration, calibrationObject);
+    }
+
+    int numEvents = 0;
+    Event event;
+    while (numEvents < FRAME_MAX_ITEMS && eventQueue.pop(event)) {
+      ArduinoJson::JsonObject dataObject = events.createNestedObject();
+      dataObject["CreatedOn"] = event.CreatedOn;
+      dataObject["Type"] = event.Type;
+      numEvents++;
+    }
+
+    int numResults = 0;
+    CommandResult result;
+    ArduinoJson::JsonArray results = statusDoc.createNestedArray("commands");
+    while (numResults < FRAME_MAX_ITEMS && commandResultQueue.pop(result)) {
+      setJsonCommandResult(result, results.createNestedObject());
+      numResults++;
+    }
+
+    //the rest follows in the next frame
+    if (numEvents == FRAME_MAX_ITEMS || numResults == FRAME_MAX_ITEMS) {
+      xTaskNotifyGive(broadcasterTaskHandle);
+    }
+
+    if (!(hasStatus || numEvents > 0 || numResults > 0) || !controller->hasWebClients()) {
+      continue;
+    }
+    if (statusDoc.overflowed() || measureJson(statusDoc) >= sizeof(serializedStatus)) {
+      //a truncated frame would lose events or command results without notice
+      Serial.println("Status frame too large, dropped");
+      continue;
+    }
+    serializeJson(statusDoc, serializedStatus, sizeof(serializedStatus));
+    controller->broadcast(serializedStatus);
   }
+
+  vTaskDelete(NULL);
 }
 
 void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type,
@@ -42,9 +139,11 @@ void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventTyp
   switch (type) {
     case WS_EVT_CONNECT:
       Serial.printf("WebSocket client #%u connected from %s\n", client->id(), client->remoteIP().toString().c_str());
+      webClientCount++;
       break;
     case WS_EVT_DISCONNECT:
       Serial.printf("WebSocket client #%u disconnected\n", client->id());
+      webClientCount--;
       break;
     case WS_EVT_DATA:
       Serial.println("Data ws received");
@@ -58,6 +157,12 @@ void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventTyp
 
 //-- Rest API handlers --//
 
+//0 if no schedule is selected
+int getSelectedScheduleID() {
+  SnapshotGuard<Schedule> schedule(scheduleSnapshot, NetworkReader);
+  return schedule.get() != nullptr ? schedule->ID : 0;
+}
+
 void handleApiScheduleActivate(AsyncWebServerRequest *request) {
   //Serial.println("Handle activate schedule request");
 
@@ -72,25 +177,30 @@ void handleApiScheduleActivate(AsyncWebServerRequest *request) {
     const int id = std::stoi(pId->value().c_str());
     const bool active = pActive->value().equals("true");
 
-    if (selectedSchedule != nullptr && selectedSchedule->ID != id) {
-      dataAccess.setSelectSchedule(selectedSchedule->ID, false);
-      dataAccess.setActiveSchedule(selectedSchedule->ID, false);
+    const int selectedID = getSelectedScheduleID();
+    if (selectedID != 0 && selectedID != id) {
+      dataAccess.setSelectSchedule(selectedID, false);
+      dataAccess.setActiveSchedule(selectedID, false);
     }
 
     dataAccess.setSelectSchedule(id, true);
     dataAccess.setActiveSchedule(id, active);
 
     Schedule *newSchedule = dataAccess.getSelectedSchedule();
-    setSchedule(newSchedule);
 
     Serial.println("Selected Schedule: ");
-    if (selectedSchedule == nullptr) {
+    if (newSchedule == nullptr) {
       Serial.println("nullptr");
     } else {
-      Serial.println(selectedSchedule->Name);
+      Serial.println(newSchedule->Name);
     }
 
-    request->send(200);
+    if (setSchedule(newSchedule)) {
+      request->send(200);
+    } else {
+      delete newSchedule;
+      request->send(503);
+    }
   } catch (...) {
     request->send(400);
   }
@@ -122,17 +232,20 @@ void handleApiScheduleGet(AsyncWebServerRequest *request) {
 void handleApiScheduleDelete(AsyncWebServerRequest *request) {
   if (!request->hasParam("id")) {
     request->send(400);
+    return;
   }
   try {
     AsyncWebParameter *pId = request->getParam("id");
     const int id = std::stoi(pId->value().c_str());
     if (dataAccess.deleteSchedule(id)) {
-      if (selectedSchedule != nullptr && selectedSchedule->ID == id) {
-        selectedSchedule = nullptr;
-      }
       Serial.print("Deleted schedule (ID=");
       Serial.print(std::to_string(id).c_str());
       Serial.println(")");
+      //the loop still runs the deleted schedule if the command queue is full
+      if (getSelectedScheduleID() == id && !setSchedule(nullptr)) {
+        request->send(503);
+        return;
+      }
       request->send(200);
     } else {
       request->send(404);
@@ -162,13 +275,18 @@ void handleApiSchedule(AsyncWebServerRequest *request, uint8_t *data) {
       {
         Serial.println("PUT");
         Schedule *schedule = deserializeSchedule((char *)data);
-        if (dataAccess.updateSchedule(schedule)) {
+        if (!dataAccess.updateSchedule(schedule)) {
+          delete schedule;
+          request->send(500);
+        } else if (schedule->ID != getSelectedScheduleID()) {
+          delete schedule;
+          request->send(200);
+        } else if (setSchedule(schedule)) {
           request->send(200);
-          if (schedule->ID == selectedSchedule->ID) {
-            setSchedule(schedule);
-          }
         } else {
-          request->send(500);
+          //stored, but the loop keeps the previous version
+          delete schedule;
+          request->send(503);
         }
         return;
       }
@@ -203,18 +321,37 @@ void handleApiSettingsHistory(AsyncWebServerRequest *request) {
 }
 
 void handleApiSettingsGet(AsyncWebServerRequest *request) {
-  String response = serializeUserSettings(userSettings);
+  String response;
+  {
+    SnapshotGuard<UserSettings> settings(userSettingsSnapshot, NetworkReader);
+    if (settings.get() == nullptr) {
+      request->send(503);
+      return;
+    }
+    response = serializeUserSettings(settings.get());
+  }
   request->send(200, "application/json", response);
 }
 
 void handleApiSettingsPut(AsyncWebServerRequest *request, uint8_t *data) {
   UserSettings *updatedUserSettings = deserializeUserSettings((char *)data);
-  if (dataAccess.updateUserSettings(updatedUserSettings)) {
-    delete userSettings;
-    userSettings = updatedUserSettings;
+  if (!dataAccess.updateUserSettings(updatedUserSettings)) {
+    delete updatedUserSettings;
+    request->send(500);
+  } else if (setUserSettings(updatedUserSettings)) {
     request->send(200);
   } else {
-    request->send(500);
+    delete updatedUserSettings;
+    request->send(503);
+  }
+}
+
+//the command is executed by the control loop, the result is sent via websocket
+void sendCommandAccepted(AsyncWebServerRequest *request, int commandID) {
+  if (commandID > 0) {
+    request->send(202, "application/json", std::to_string(commandID).c_str());
+  } else {
+    request->send(503);
   }
 }
 
@@ -224,7 +361,7 @@ void handleApiContainer(AsyncWebServerRequest *request) {
     return;
   }
 
-  if (currentStatus->AutomaticFeeding) {
+  if (getStatusSnapshot().AutomaticFeeding) {
     request->send(409);
     return;
   }
@@ -232,15 +369,7 @@ void handleApiContainer(AsyncWebServerRequest *request) {
   AsyncWebParameter *p = request->getParam("open");
   bool open = p->value().equals("true");
 
-  if (open) {
-    openContainer();
-    currentStatus->ManualFeeding = true;
-  } else {
-    closeContainer();
-    currentStatus->ManualFeeding = false;
-  }
-
-  request->send(200);
+  sendCommandAccepted(request, requestContainer(open));
 }
 
 void handleApiScaleTare(AsyncWebServerRequest *request) {
@@ -253,24 +382,22 @@ void handleApiScaleTare(AsyncWebServerRequest *request) {
   }
 
   String param = request->getParam("scale")->value().c_str();
-  bool success = false;
+  Command command = {};
+  command.Type = TareCommand;
 
   if (param == "A") {
     Serial.println("of scale A");
-    success = machineController.tareContainerScale();
+    command.ScaleID = Container;
   } else if (param == "B") {
     Serial.println("of scale B");
-    success = machineController.tarePlateScale();
+    command.ScaleID = Plate;
   } else {
     Serial.println("failed");
     request->send(400);
+    return;
   }
 
-  if (success) {
-    request->send(200);
-  } else {
-    request->send(500);
-  }
+  sendCommandAccepted(request, sendCommand(command));
 }
 
 void handleApiScaleCalibration(AsyncWebServerRequest *request) {
@@ -283,39 +410,81 @@ void handleApiScaleCalibration(AsyncWebServerRequest *request) {
   }
 
   String param = request->getParam("scale")->value().c_str();
-  const double targetWeight = std::stod(request->getParam("targetWeight")->value().c_str());
-  bool success = false;
+  Command command = {};
+  command.Type = CalibrationCommand;
+  try {
+    command.Weight = std::stod(request->getParam("targetWeight")->value().c_str());
+    command.Points = request->hasParam("points") ? std::stoi(request->getParam("points")->value().c_str()) : 1;
+  } catch (...) {
+    Serial.println("failed");
+    request->send(400);
+    return;
+  }
+  command.Quadratic = request->hasParam("quadratic") && request->getParam("quadratic")->value().equals("true");
 
   if (param == "A") {
     Serial.println("of scale A");
-    success = machineController.calibrateContainerScale(targetWeight);
+    command.ScaleID = Container;
   } else if (param == "B") {
     Serial.println("of scale B");
-    success = machineController.calibratePlateScale(targetWeight);
+    command.ScaleID = Plate;
   } else {
     Serial.println("failed");
     request->send(400);
+    return;
   }
 
-  if (success) {
-    request->send(200);
-  } else {
-    request->send(500);
+  //the command result holds the job ID, progress and result of the job are sent via websocket
+  sendCommandAccepted(request, sendCommand(command));
+}
+
+void handleApiScaleCalibrationPoint(AsyncWebServerRequest *request) {
+  Serial.println("Hanlde Api scale calibration point");
+
+  if (!request->hasParam("job") || !request->hasParam("targetWeight")) {
+    request->send(400);
+    return;
+  }
+
+  try {
+    Command command = {};
+    command.Type = CalibrationPointCommand;
+    command.JobID = std::stoi(request->getParam("job")->value().c_str());
+    command.Weight = std::stod(request->getParam("targetWeight")->value().c_str());
+    sendCommandAccepted(request, sendCommand(command));
+  } catch (...) {
+    request->send(400);
   }
 }
 
-void handleApiPlateTare(AsyncWebServerRequest *request) {
-  Serial.print("Handle Api plate tare ");
+void handleApiScaleCalibrationCancel(AsyncWebServerRequest *request) {
+  Serial.println("Hanlde Api scale calibration cancel");
 
-  if (machineController.tarePlateScaleWithPlate()) {
-    request->send(200);
-  } else {
-    request->send(500);
+  if (!request->hasParam("job")) {
+    request->send(400);
+    return;
   }
+
+  try {
+    Command command = {};
+    command.Type = CalibrationCancelCommand;
+    command.JobID = std::stoi(request->getParam("job")->value().c_str());
+    sendCommandAccepted(request, sendCommand(command));
+  } catch (...) {
+    request->send(400);
+  }
+}
+
+void handleApiPlateTare(AsyncWebServerRequest *request) {
+  Serial.println("Handle Api plate tare ");
+
+  Command command = {};
+  command.Type = PlateTareCommand;
+  sendCommandAccepted(request, sendCommand(command));
 }
 
 void handleApiContainerAngle(AsyncWebServerRequest *request) {
-   Serial.print("Hanlde Api Container anlge ");
+  Serial.println("Hanlde Api Container anlge ");
 
   if (!request->hasParam("open") || !request->hasParam("angle")) {
     Serial.println("failed");
@@ -323,30 +492,37 @@ void handleApiContainerAngle(AsyncWebServerRequest *request) {
     return;
   }
 
-  bool open = request->getParam("open")->value().equals("true");;
-  const int angle = std::stoi(request->getParam("angle")->value().c_str());
-  bool success = false;
-
-  if (!open) {
-    Serial.print("(Closed)");
-    systemSettings->ContainerAngleClose = angle;
-    success = dataAccess.updateSystemSettings(systemSettings);
-    machineController.closeContainer();
-  } else {
-    Serial.print("(Open)");
-    systemSettings->ContainerAngleOpen = angle;
-    success = dataAccess.updateSystemSettings(systemSettings);
-    machineController.openContainer();
+  Command command = {};
+  command.Type = ContainerAngleCommand;
+  command.Open = request->getParam("open")->value().equals("true");
+  try {
+    command.Angle = std::stoi(request->getParam("angle")->value().c_str());
+  } catch (...) {
+    Serial.println("failed");
+    request->send(400);
+    return;
   }
+  sendCommandAccepted(request, sendCommand(command));
+}
 
-  if (success) {
-    Serial.print(", New Angle: ");
-    Serial.println(angle);
-    request->send(200);
-  } else {
-    Serial.println(", Failed! ");
-    request->send(500);
-  }
+void handleApiCommandMetrics(AsyncWebServerRequest *request) {
+  String response = serializeCommandMetrics(getCommandMetrics());
+  request->send(200, "application/json", response);
+}
+
+void handleApiLoopMetrics(AsyncWebServerRequest *request) {
+  String response = serializeLoopGovernorStats(getLoopGovernorStats());
+  request->send(200, "application/json", response);
+}
+
+void handleApiPowerMetrics(AsyncWebServerRequest *request) {
+  String response = serializePowerStats(getPowerStats());
+  request->send(200, "application/json", response);
+}
+
+void handleApiFeedTrace(AsyncWebServerRequest *request) {
+  String response = serializeFeedTrace(getFeedTrace());
+  request->send(200, "application/json", response);
 }
 
 //---//
@@ -376,31 +552,6 @@ bool NetworkController::initNetworkConnection(Config *config) {
   return true;
 }
 
-bool NetworkController::initNTP() {
-  ntpClient.begin();
-  while (!ntpClient.update()) {
-    Serial.println("Couldn't fetch time via NTP...");
-    delay(4000);
-  }
-  startUpTimestamp = ntpClient.getEpochTime();
-  today = getDay(startUpTimestamp);
-  startUpDaytimeMS = (startUpTimestamp - today * 86400L) * 1000;
-  return true;
-}
-
-long NetworkController::getCurrentDaytime() {
-  //@TODO: handle millis overflow and ntp updates!
-  /*if(getDay(millis) > DAYS_UNTIL_NTP_UPDATE){
-    ntpClient.update();
-    startUpMillis = ntpClient.getEpochTime();
-  }*/
-  return startUpDaytimeMS + millis();
-}
-
-int NetworkController::getToday() {
-  return today;
-};
-
 bool NetworkController::initWebserver() {
   ws.onEvent(onWsEvent);
   server.addHandler(&ws);
@@ -414,9 +565,27 @@ bool NetworkController::initWebserver() {
   server.on("/api/settings/tare", HTTP_GET, [](AsyncWebServerRequest *request) {
     handleApiScaleTare(request);
   });
+  server.on("/api/settings/calibration/point", HTTP_GET, [](AsyncWebServerRequest *request) {
+    handleApiScaleCalibrationPoint(request);
+  });
+  server.on("/api/settings/calibration/cancel", HTTP_GET, [](AsyncWebServerRequest *request) {
+    handleApiScaleCalibrationCancel(request);
+  });
   server.on("/api/settings/calibration", HTTP_GET, [](AsyncWebServerRequest *request) {
     handleApiScaleCalibration(request);
   });
+  server.on("/api/metrics/commands", HTTP_GET, [](AsyncWebServerRequest *request) {
+    handleApiCommandMetrics(request);
+  });
+  server.on("/api/metrics/loop", HTTP_GET, [](AsyncWebServerRequest *request) {
+    handleApiLoopMetrics(request);
+  });
+  server.on("/api/metrics/power", HTTP_GET, [](AsyncWebServerRequest *request) {
+    handleApiPowerMetrics(request);
+  });
+  server.on("/api/metrics/feed", HTTP_GET, [](AsyncWebServerRequest *request) {
+    handleApiFeedTrace(request);
+  });
   server.on("/api/settings/containerAngle", HTTP_GET, [](AsyncWebServerRequest *request) {
     handleApiContainerAngle(request);
   });
@@ -477,16 +646,48 @@ bool NetworkController::initWebserver() {
 
   server.begin();
   Serial.println("Web Server started");
-  //xTaskCreatePinnedToCore(clearClientsTask, "ClearClientsTask", 4096, NULL, 1, &clearClientsTaskHandle, 1); //@TODO: Why causes this AsyncTCP timeout???
   return true;
 }
 
 bool NetworkController::hasWebClients() {
-  return ws.count() > 0;
+  return webClientCount > 0;
+}
+
+int NetworkController::getWebClientCount() {
+  return webClientCount;
 }
 
 void NetworkController::broadcast(const char *serializedMessage) {
   if (ws.availableForWriteAll()) {
     ws.textAll(serializedMessage);
   }
-}
\ No newline at end of file
+}
+
+bool NetworkController::startBroadcaster() {
+  if (xTaskCreatePinnedToCore(broadcasterTask, "Broadcaster", 4096, this, 1, &broadcasterTaskHandle, NETWORK_CORE) != pdPASS) {
+    return false;
+  }
+  const int cleanupTimer = timerService.create(cleanupClientsTimeout, nullptr);
+  if (cleanupTimer < 0) {
+    Serial.println("Couldnt create websocket cleanup timer, raise TIMER_MAX_TIMERS!");
+    return false;
+  }
+  timerService.schedule(cleanupTimer, CLEAN_CLIENTS_INTERVAL * 1000, CLEAN_CLIENTS_INTERVAL * 1000);
+  return true;
+}
+
+bool NetworkController::publishStatus(const StatusMessage &message) {
+  const bool queued = statusQueue.push(message);
+  if (broadcasterTaskHandle != nullptr) {
+    xTaskNotifyGive(broadcasterTaskHandle);
+  }
+  return queued;
+}
+
+bool NetworkController::publishEvent(const Event &event) {
+  return eventQueue.push(event);
+}
+
+bool NetworkController::publishCommandResult(const CommandResult &result) {
+  return commandResultQueue.push(result);
+}
@@ -4,30 +4,51 @@
 #include "Models.h"
 #include "DataAccess.h"
 #include "MachineController.h"
+#include "ScaleCalibration.h"
+#include "FeedStateMachine.h"
+#include "LoopGovernor.h"
+#include "PowerManager.h"
+#include "Snapshot.h"
+#include "TimerService.h"
 
 extern DataAccess dataAccess;
 extern MachineController machineController;
-extern Schedule* selectedSchedule;
-extern UserSettings* userSettings;
+extern TimerService timerService;
+extern Snapshot<Schedule> scheduleSnapshot;
+extern Snapshot<UserSettings> userSettingsSnapshot;
 extern SystemSettings* systemSettings;
-extern MachineStatus* currentStatus;
 
-extern void setSchedule(Schedule* newSchedule);
-extern long getDay(long timestamp);
-extern void openContainer();
-extern void closeContainer();
+extern bool setSchedule(Schedule* newSchedule);
+extern bool setUserSettings(UserSettings* newUserSettings);
+extern MachineStatus getStatusSnapshot();
+extern int requestContainer(bool open);
+extern int sendCommand(Command& command);
+extern CommandMetrics getCommandMetrics();
+extern LoopGovernorStats getLoopGovernorStats();
+extern PowerStats getPowerStats();
+extern FeedTrace getFeedTrace();
+
+//status of one loop iteration for the websocket clients
+struct StatusMessage {
+  MachineStatus Status;
+  bool HasCalibration;
+  CalibrationJob Calibration;
+};
 
 class NetworkController {
 public:
   bool initNetworkConnection(Config* config);
 
-  bool initNTP();
-  long getCurrentDaytime();
-  int getToday();
-
   bool initWebserver();
-  bool hasWebClients();
+  bool hasWebClients();     //any task
+  int getWebClientCount();  //any task
   void broadcast(const char* serializedMessage);
+
+  //called by the control loop only, the broadcaster task on the network core sends them to the clients
+  bool startBroadcaster();
+  bool publishStatus(const StatusMessage& message);
+  bool publishEvent(const Event& event);
+  bool publishCommandResult(const CommandResult& result);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,125 @@
+#include "PowerManager.h"
+#include <esp_timer.h>
+#include <WiFi.h>
+#include <Arduino.h>
+
+PowerManager::PowerManager()
+  : pmEnabled(false), performance(false), sleepAllowed(true), performanceLock(nullptr), noSleepLock(nullptr), lastAccount(0), waitStart(0), expectedWake(0),
+    waitTime(0), totalTime(0), awakeTime(0), performanceTime(0), energy(0), stats() {}
+
+//after the WiFi connection, light sleep needs the modem sleep of the WiFi driver
+bool PowerManager::init() {
+  WiFi.setSleep(true);
+
+  esp_pm_config_esp32_t config = {};
+  config.max_freq_mhz = POWER_MAX_FREQ;
+  config.min_freq_mhz = POWER_MIN_FREQ;
+  config.light_sleep_enable = true;
+  esp_err_t result = esp_pm_configure(&config);
+  if (result != ESP_OK) {
+    //light sleep needs the tickless idle of FreeRTOS
+    config.light_sleep_enable = false;
+    result = esp_pm_configure(&config);
+  }
+  pmEnabled = result == ESP_OK && esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "control", &performanceLock) == ESP_OK
+              && esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "pwm", &noSleepLock) == ESP_OK;
+  stats.LightSleep = pmEnabled && config.light_sleep_enable;
+
+  Serial.print("Power management: ");
+  Serial.println(stats.LightSleep ? "light sleep" : (pmEnabled ? "frequency scaling" : "manual frequency switching"));
+
+  lastAccount = esp_timer_get_time();
+  setPerformance(true);
+  return pmEnabled;
+}
+
+bool PowerManager::update(bool busy, bool webClients, long untilFeedMS, bool pwmOutputs) {
+  account(esp_timer_get_time());
+  setPerformance(busy || webClients || untilFeedMS <= POWER_WAKE_LEAD);
+  setSleepAllowed(!pwmOutputs);
+  stats.Performance = performance;
+  publishedStats.write(stats);
+  return performance;
+}
+
+bool PowerManager::isPerformance() {
+  return performance;
+}
+
+void PowerManager::beginWait(long feedWaitMS) {
+  waitStart = esp_timer_get_time();
+  expectedWake = feedWaitMS >= 0 ? waitStart + (int64_t)feedWaitMS * 1000 : 0;
+}
+
+void PowerManager::endWait(bool timedOut) {
+  const int64_t now = esp_timer_get_time();
+  waitTime += now - waitStart;
+  if (timedOut && expectedWake > 0) {
+    const int64_t latency = now > expectedWake ? now - expectedWake : 0;
+    stats.LastFeedWakeLatency = latency;
+    stats.MaxFeedWakeLatency = max(stats.MaxFeedWakeLatency, latency);
+    stats.FeedWakeups++;
+  }
+}
+
+PowerStats PowerManager::getStats() {
+  return publishedStats.read();
+}
+
+//a lock held at full clock keeps the CPU out of light sleep as well
+void PowerManager::setPerformance(bool newPerformance) {
+  if (newPerformance == performance) {
+    return;
+  }
+  performance = newPerformance;
+
+  if (pmEnabled) {
+    if (performance) {
+      esp_pm_lock_acquire(performanceLock);
+    } else {
+      esp_pm_lock_release(performanceLock);
+    }
+  } else {
+    setCpuFrequencyMhz(performance ? POWER_MAX_FREQ : POWER_MIN_FREQ);
+  }
+}
+
+void PowerManager::setSleepAllowed(bool allowed) {
+  if (allowed == sleepAllowed) {
+    return;
+  }
+  sleepAllowed = allowed;
+
+  if (pmEnabled) {
+    if (sleepAllowed) {
+      esp_pm_lock_release(noSleepLock);
+    } else {
+      esp_pm_lock_acquire(noSleepLock);
+    }
+  }
+}
+
+//time since the last update in the mode that was active, the waiting time is spent sleeping if possible
+void PowerManager::account(int64_t now) {
+  const int64_t elapsed = now - lastAccount;
+  if (elapsed <= 0) {
+    return;
+  }
+  const int64_t waiting = min(waitTime, elapsed);
+  const int64_t awake = elapsed - waiting;
+
+  if (performance) {
+    energy += POWER_CURRENT_MAX * elapsed;
+    performanceTime += elapsed;
+  } else {
+    energy += POWER_CURRENT_MIN * awake + (stats.LightSleep && sleepAllowed ? POWER_CURRENT_SLEEP : POWER_CURRENT_MIN) * waiting;
+  }
+  totalTime += elapsed;
+  awakeTime += awake;
+  waitTime = 0;
+  lastAccount = now;
+
+  stats.DutyCycle = (double)awakeTime / totalTime;
+  stats.PerformanceShare = (double)performanceTime / totalTime;
+  stats.EstimatedPower = energy / totalTime * POWER_VOLTAGE;
+}
@@ -0,0 +1,75 @@
+#ifndef POWERMANAGER_H
+#define POWERMANAGER_H
+
+#include <stdint.h>
+#include <esp_pm.h>
+#include "SeqLock.h"
+
+//Dynamic frequency scaling and automatic light sleep. While the feeder is idle and no websocket client
+//is connected, the CPU runs at POWER_MIN_FREQ and sleeps whenever all tasks are blocked. FreeRTOS wakes it for
+//the next task timeout, so the control loop still wakes for the next feed; it switches to full clock
+//POWER_WAKE_LEAD before. WiFi stays associated in modem sleep and wakes for the beacons.
+//Light sleep stops the LEDC clock, so it is also blocked while a PWM output has to keep running
+//(the servo holding pulse, a blinking LED).
+//Without power management support in the SDK, only the CPU frequency is switched.
+//The duty cycle and the power estimate are measured around the wait of the control loop only. The sampler
+//blocks on the data ready edge of the HX711 and is awake only to shift out a conversion (well below 1 ms per
+//reading), the network and storage tasks are not counted. The radio current is not part of the estimate.
+
+const uint32_t POWER_MAX_FREQ = 240;  //MHz
+const uint32_t POWER_MIN_FREQ = 80;   //MHz, the lowest frequency with the APB clock (and WiFi) at 80 MHz
+const long POWER_WAKE_LEAD = 500;     //ms before a feed, the feed starts at full clock and without a sleep wakeup
+
+//rough ESP32 currents without the radio (datasheet), for the power estimate only
+const double POWER_CURRENT_MAX = 68;     //mA, at POWER_MAX_FREQ
+const double POWER_CURRENT_MIN = 31;     //mA, at POWER_MIN_FREQ
+const double POWER_CURRENT_SLEEP = 0.8;  //mA, light sleep
+const double POWER_VOLTAGE = 3.3;
+
+struct PowerStats {
+  bool LightSleep;              //automatic light sleep is available
+  bool Performance;             //full clock right now
+  double DutyCycle;             //share of the time the control loop is awake, the other tasks are not counted
+  double PerformanceShare;      //share of the time at full clock
+  double EstimatedPower;        //mW, average
+  int64_t LastFeedWakeLatency;  //µs, wakeup after the feed time
+  int64_t MaxFeedWakeLatency;   //µs
+  uint32_t FeedWakeups;
+};
+
+class PowerManager {
+public:
+  PowerManager();
+  bool init();
+  bool update(bool busy, bool webClients, long untilFeedMS, bool pwmOutputs);  //true if at full clock
+  bool isPerformance();
+
+  //around the blocking wait of the control loop, feedWaitMS is the wait if it ends at a feed time, otherwise -1
+  void beginWait(long feedWaitMS);
+  void endWait(bool timedOut);
+
+  PowerStats getStats();  //any task
+
+private:
+  void setPerformance(bool performance);
+  void setSleepAllowed(bool allowed);
+  void account(int64_t now);
+
+  bool pmEnabled;
+  bool performance;
+  bool sleepAllowed;
+  esp_pm_lock_handle_t performanceLock;
+  esp_pm_lock_handle_t noSleepLock;
+  int64_t lastAccount;   //µs, monotonic
+  int64_t waitStart;
+  int64_t expectedWake;  //µs, 0 = the wait does not end at a feed time
+  int64_t waitTime;      //µs since lastAccount
+  int64_t totalTime;
+  int64_t awakeTime;
+  int64_t performanceTime;
+  double energy;         //mA * µs
+  PowerStats stats;
+  SeqLock<PowerStats> publishedStats;
+};
+
+#endif
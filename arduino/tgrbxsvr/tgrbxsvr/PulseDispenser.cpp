@@ -0,0 +1,80 @@
+#include "PulseDispenser.h"
+#include <Arduino.h>
+
+void PulseDispenser::start(int64_t timestamp, double containerLoad, double requestedWeight, double emptyContainerLoad) {
+  active = true;
+  startLoad = containerLoad;
+  lastLoad = containerLoad;
+  requested = requestedWeight;
+  emptyLoad = emptyContainerLoad;
+  pulseDuration = PULSE_INITIAL_DURATION;
+  massPerSecond = 0;
+  pulses = 0;
+  emptyPulses = 0;
+  //nothing to settle before the first pulse
+  closeTimestamp = timestamp - PULSE_SETTLE_TIME * 1000;
+}
+
+//called while the container is closed, decides about the next pulse
+PulseAction PulseDispenser::update(int64_t timestamp, double containerLoad, double flowRate) {
+  if (!active) {
+    return PulseNone;
+  }
+
+  if (timestamp - closeTimestamp < PULSE_SETTLE_TIME * 1000 || abs(flowRate) > PULSE_SETTLED_FLOW) {
+    return PulseNone;
+  }
+
+  if (pulses > 0) {
+    const double pulseMass = lastLoad - containerLoad;
+    if (pulseMass < PULSE_MIN_MASS) {
+      if (pulseDuration >= PULSE_MAX_DURATION) {
+        emptyPulses++;
+      }
+    } else {
+      emptyPulses = 0;
+      massPerSecond = pulseMass / pulseDuration;
+    }
+  }
+
+  const double remaining = requested - (startLoad - containerLoad);
+  if (remaining <= PULSE_TOLERANCE || pulses >= PULSE_MAX_PULSES) {
+    active = false;
+    return PulseDone;
+  }
+
+  //an empty container does not change the weight either
+  if (containerLoad <= emptyLoad) {
+    active = false;
+    return PulseEmpty;
+  }
+
+  if (emptyPulses >= PULSE_MAX_EMPTY) {
+    active = false;
+    return PulseFailed;
+  }
+
+  if (massPerSecond > 0) {
+    pulseDuration = max(PULSE_MIN_DURATION, min(PULSE_MAX_DURATION, PULSE_AIM * remaining / massPerSecond));
+  } else if (pulses > 0) {
+    //nothing came out yet, try longer
+    pulseDuration = min(PULSE_MAX_DURATION, pulseDuration * 2);
+  }
+
+  lastLoad = containerLoad;
+  pulseStart = timestamp;
+  pulses++;
+  return PulseOpen;
+}
+
+double PulseDispenser::getRemainingPulseTime(int64_t timestamp) {
+  return pulseDuration - (double)(timestamp - pulseStart) / 1000;
+}
+
+void PulseDispenser::pulseClosed(int64_t timestamp) {
+  closeTimestamp = timestamp;
+}
+
+bool PulseDispenser::isActive() {
+  return active;
+}
@@ -0,0 +1,50 @@
+#ifndef PULSEDISPENSER_H
+#define PULSEDISPENSER_H
+
+#include <stdint.h>
+
+//Dispenses small portions with short open/close pulses. After every pulse the weight has to settle,
+//the dispensed mass of the pulse gives the flow per second of opening, which sizes the next pulse.
+
+const double PULSE_INITIAL_DURATION = 0.3;  //seconds, until the first pulse was measured
+const double PULSE_MIN_DURATION = 0.05;     //seconds
+const double PULSE_MAX_DURATION = 2;        //seconds
+const double PULSE_AIM = 0.8;               //aim a bit short, the next pulse makes up for the rest
+const double PULSE_SETTLE_TIME = 0.5;       //seconds after closing before measuring
+const double PULSE_SETTLED_FLOW = 0.5;      //gramm/second
+const double PULSE_TOLERANCE = 0.5;         //gramm
+const double PULSE_MIN_MASS = 0.2;          //gramm, less counts as an empty pulse
+const int PULSE_MAX_PULSES = 20;
+const int PULSE_MAX_EMPTY = 3;              //empty pulses in a row at maximum duration until failure
+
+enum PulseAction {
+  PulseNone,
+  PulseOpen,
+  PulseDone,
+  PulseEmpty,  //the container ran empty, not a motor failure
+  PulseFailed
+};
+
+class PulseDispenser {
+public:
+  void start(int64_t timestamp, double containerLoad, double requestedWeight, double emptyLoad);
+  PulseAction update(int64_t timestamp, double containerLoad, double flowRate);
+  double getRemainingPulseTime(int64_t timestamp);
+  void pulseClosed(int64_t timestamp);
+  bool isActive();
+
+private:
+  bool active = false;
+  int64_t pulseStart = 0;
+  int64_t closeTimestamp = 0;
+  double pulseDuration = PULSE_INITIAL_DURATION;
+  double startLoad = 0;
+  double requested = 0;
+  double emptyLoad = 0;  //container load at which nothing is left to dispense
+  double lastLoad = 0;
+  double massPerSecond = 0;
+  int pulses = 0;
+  int emptyPulses = 0;
+};
+
+#endif
@@ -0,0 +1,161 @@
+#include "ScaleCalibration.h"
+#include "MachineController.h"
+
+extern MachineController machineController;
+
+int ScaleCalibration::start(Scale scale, double weight, int numPoints, bool quadratic) {
+  if (isActive() || numPoints < 1 || numPoints > CALIBRATION_MAX_POINTS || (quadratic && numPoints < 2)) {
+    return 0;
+  }
+
+  job.ID = nextID++;
+  job.ScaleID = scale;
+  job.Quadratic = quadratic;
+  job.NumPoints = numPoints;
+  job.PointCount = 0;
+  job.ScaleFactor = 0;
+  job.QuadraticFactor = 0;
+  job.CurrentWeight = weight;
+  job.CollectedReadings = 0;
+  job.ValueSum = 0;
+  //set last, the control loop starts collecting as soon as the state changes
+  job.State = CalibrationCollecting;
+  changed = true;
+  return job.ID;
+}
+
+bool ScaleCalibration::addPoint(int jobID, double weight) {
+  if (jobID != job.ID || job.State != CalibrationWaiting) {
+    return false;
+  }
+
+  job.CurrentWeight = weight;
+  job.CollectedReadings = 0;
+  job.ValueSum = 0;
+  job.State = CalibrationCollecting;
+  changed = true;
+  return true;
+}
+
+bool ScaleCalibration::cancel(int jobID) {
+  if (jobID != job.ID || !isActive()) {
+    return false;
+  }
+
+  Serial.println("Calibration cancelled");
+  job.State = CalibrationCancelled;
+  changed = true;
+  return true;
+}
+
+bool ScaleCalibration::isActive() {
+  return job.State == CalibrationCollecting || job.State == CalibrationWaiting;
+}
+
+bool ScaleCalibration::hasChanged() {
+  return changed;
+}
+
+void ScaleCalibration::clearChanged() {
+  changed = false;
+}
+
+const CalibrationJob& ScaleCalibration::getJob() {
+  return job;
+}
+
+void ScaleCalibration::update(const ScaleSample& sample, int64_t timestamp) {
+  if (job.State == CalibrationWaiting && timestamp - job.WaitingSince >= CALIBRATION_POINT_TIMEOUT) {
+    Serial.println("Calibration timed out");
+    job.State = CalibrationFailed;
+    changed = true;
+    return;
+  }
+
+  //the loop also wakes without a new sample, a reading must not be counted twice
+  const bool newSample = sample.Sequence != lastSequence;
+  lastSequence = sample.Sequence;
+  if (job.State != CalibrationCollecting || !newSample) {
+    return;
+  }
+
+  job.ValueSum += job.ScaleID == Container ? sample.ContainerValue : sample.PlateValue;
+  job.CollectedReadings++;
+  changed = true;
+
+  if (job.CollectedReadings < CALIBRATION_READINGS) {
+    return;
+  }
+
+  CalibrationPoint point;
+  point.Weight = job.CurrentWeight;
+  point.Value = job.ValueSum / job.CollectedReadings;
+  job.Points[job.PointCount++] = point;
+  Serial.print("Calibration point ");
+  Serial.print(job.PointCount);
+  Serial.print(": ");
+  Serial.print(point.Weight);
+  Serial.print("g = ");
+  Serial.println(point.Value);
+
+  if (job.PointCount < job.NumPoints) {
+    job.WaitingSince = timestamp;
+    job.State = CalibrationWaiting;
+    return;
+  }
+
+  if (fit() && machineController.storeScaleCalibration(job.ScaleID, job.ScaleFactor, job.QuadraticFactor)) {
+    job.State = CalibrationDone;
+  } else {
+    job.State = CalibrationFailed;
+  }
+}
+
+bool ScaleCalibration::fit() {
+  //weight = b * value + c * value^2, the tare point (0, 0) is exact.
+  //values are normalized to avoid huge powers in the sums.
+  double norm = 0;
+  for (int i = 0; i < job.PointCount; i++) {
+    const CalibrationPoint& point = job.Points[i];
+    norm = max(norm, abs(point.Value));
+  }
+  if (norm == 0) {
+    return false;
+  }
+
+  double sxx = 0, sx3 = 0, sx4 = 0, swx = 0, swx2 = 0;
+  for (int i = 0; i < job.PointCount; i++) {
+    const CalibrationPoint& point = job.Points[i];
+    const double x = point.Value / norm;
+    sxx += x * x;
+    sx3 += x * x * x;
+    sx4 += x * x * x * x;
+    swx += point.Weight * x;
+    swx2 += point.Weight * x * x;
+  }
+
+  double b = 0;
+  double c = 0;
+  if (job.Quadratic) {
+    const double det = sxx * sx4 - sx3 * sx3;
+    if (abs(det) < 1e-12) {
+      return false;
+    }
+    b = (swx * sx4 - swx2 * sx3) / det;
+    c = (sxx * swx2 - sx3 * swx) / det;
+  } else {
+    b = swx / sxx;
+  }
+
+  if (b == 0) {
+    return false;
+  }
+
+  //back to raw values: weight = (b / norm) * value + (c / norm^2) * value^2
+  //as scale factor and quadratic term of the linear load: load = linear + q * linear^2, linear = value / scaleFactor
+  const double bRaw = b / norm;
+  const double cRaw = c / (norm * norm);
+  job.ScaleFactor = 1 / bRaw;
+  job.QuadraticFactor = cRaw / (bRaw * bRaw);
+  return true;
+}
@@ -0,0 +1,68 @@
+#ifndef SCALECALIBRATION_H
+#define SCALECALIBRATION_H
+
+#include <stdint.h>
+#include "Models.h"
+
+//Multi point calibration of a scale, running in the background of the control loop.
+//The caller starts a job and places the reference weights one after another, the loop collects
+//the readings for every point. After the last point the scale factor (and optionally a quadratic term)
+//is fitted by least squares through the tare point and stored in the system settings.
+//A job that waits longer than CALIBRATION_POINT_TIMEOUT for the next weight fails, so an abandoned job
+//does not hold back the feeds for good.
+
+const int CALIBRATION_READINGS = 10;  //readings per reference weight
+const int CALIBRATION_MAX_POINTS = 8;
+const int64_t CALIBRATION_POINT_TIMEOUT = 300000;  //ms, shorter than FEED_MAX_POSTPONE, a postponed feed still runs
+
+enum CalibrationState {
+  CalibrationIdle,
+  CalibrationCollecting,  //collecting readings for the current reference weight
+  CalibrationWaiting,     //waiting for the next reference weight
+  CalibrationDone,
+  CalibrationFailed,
+  CalibrationCancelled
+};
+
+struct CalibrationPoint {
+  double Weight;
+  double Value;  //averaged raw value minus offset
+};
+
+struct CalibrationJob {
+  int ID;
+  Scale ScaleID;
+  bool Quadratic;
+  int NumPoints;
+  CalibrationState State;
+  double CurrentWeight;
+  int64_t WaitingSince;  //unix ms
+  int CollectedReadings;
+  double ValueSum;
+  CalibrationPoint Points[CALIBRATION_MAX_POINTS];
+  int PointCount;
+  double ScaleFactor;
+  double QuadraticFactor;
+};
+
+class ScaleCalibration {
+public:
+  int start(Scale scale, double weight, int numPoints, bool quadratic);
+  bool addPoint(int jobID, double weight);
+  bool cancel(int jobID);
+  bool isActive();
+  bool hasChanged();
+  void clearChanged();  //after the job was published
+  void update(const ScaleSample& sample, int64_t timestamp);  //once per loop, only a new sample is collected
+  const CalibrationJob& getJob();
+
+private:
+  bool fit();
+
+  CalibrationJob job = {};
+  int nextID = 1;
+  bool changed = false;
+  unsigned long lastSequence = 0;
+};
+
+#endif
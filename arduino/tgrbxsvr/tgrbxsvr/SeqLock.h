@@ -0,0 +1,40 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <stdint.h>
+
+//Single writer, multiple reader value without locks.
+//The writer never waits, readers retry while a write is in progress (odd sequence) or happened during their copy.
+//T has to be trivially copyable.
+template<typename T>
+class SeqLock {
+public:
+  SeqLock()
+    : sequence(0), value() {}
+
+  void write(const T& newValue) {
+    const uint32_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    value = newValue;
+    sequence.store(seq + 2, std::memory_order_release);
+  }
+
+  T read() const {
+    T snapshot;
+    uint32_t seq;
+    do {
+      seq = sequence.load(std::memory_order_acquire);
+      snapshot = value;
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1) != 0 || seq != sequence.load(std::memory_order_relaxed));
+    return snapshot;
+  }
+
+private:
+  std::atomic<uint32_t> sequence;
+  T value;
+};
+
+#endif
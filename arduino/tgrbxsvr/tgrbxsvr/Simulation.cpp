@@ -0,0 +1,58 @@
+#include "Simulation.h"
+
+#ifdef SIMULATED_PLANT
+
+extern SystemSettings* systemSettings;
+
+const double SIM_NOISE = 0.3;          //gramm, peak at 10 SPS
+const double SIM_NOISE_HIGH_RATE = 0.9;  //gramm, peak at 80 SPS
+const double SIM_MAX_FLOW = 25;        //gramm/second at full opening
+const double SIM_SERVO_SPEED = 600;    //degree/second
+const double SIM_FALL_TIME = 0.25;     //seconds until food reaches the plate
+
+SimulatedPlant simulatedPlant = { 500, 0, 0, 0, 0, false, 0, 0 };
+unsigned long noiseState = 12345;
+
+void resetSimulatedPlant(double containerMass, double plateMass) {
+  simulatedPlant.ContainerMass = containerMass;
+  simulatedPlant.PlateMass = plateMass;
+  simulatedPlant.InFlightMass = 0;
+  simulatedPlant.Jammed = false;
+}
+
+void updateSimulatedPlant(unsigned long now) {
+  SimulatedPlant& plant = simulatedPlant;
+  if (plant.LastUpdate == 0 || now <= plant.LastUpdate) {
+    plant.LastUpdate = now;
+    return;
+  }
+
+  const double dt = (double)(now - plant.LastUpdate) / 1000;
+  plant.LastUpdate = now;
+
+  const double maxStep = SIM_SERVO_SPEED * dt;
+  const double angleDiff = plant.CommandedAngle - plant.Angle;
+  plant.Angle += max(-maxStep, min(maxStep, angleDiff));
+
+  //full flow is reached at the configured opening angle, everything below the closed angle counts as closed
+  const double opening = max(0.0, min(1.0, (plant.Angle - systemSettings->ContainerAngleClose) / systemSettings->ContainerAngleOpen));
+  double flow = plant.Jammed ? 0 : opening * SIM_MAX_FLOW * dt;
+  flow = min(flow, plant.ContainerMass);
+  plant.ContainerMass -= flow;
+  plant.InFlightMass += flow;
+
+  const double landed = plant.InFlightMass * min(1.0, dt / SIM_FALL_TIME);
+  plant.InFlightMass -= landed;
+  plant.PlateMass += landed;
+}
+
+long readSimulatedRaw(Scale scale, ScaleRate rate) {
+  updateSimulatedPlant(millis());
+  simulatedPlant.Conversions++;
+  noiseState = noiseState * 1103515245 + 12345;
+  const double noise = (((double)((noiseState >> 16) & 0x7FFF) / 0x7FFF) * 2 - 1) * (rate == HighRate ? SIM_NOISE_HIGH_RATE : SIM_NOISE);
+  const double mass = scale == Container ? simulatedPlant.ContainerMass : simulatedPlant.PlateMass;
+  return SIM_ZERO_OFFSET + (mass + noise) * SIM_COUNTS_PER_GRAMM;
+}
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#ifdef SIMULATED_PLANT
+
+#include "Models.h"
+
+const double SIM_COUNTS_PER_GRAMM = 1000;  //scale factor of both simulated load cells
+const long SIM_ZERO_OFFSET = -150000;      //raw value of an empty load cell
+const long SIM_CONVERSION_TIME_LOW = 100000;  //µs, 10 SPS
+const long SIM_CONVERSION_TIME_HIGH = 12500;  //µs, 80 SPS
+
+//Simple physical model of the feeder: a container emptied through a servo driven flap onto a plate.
+struct SimulatedPlant {
+  double ContainerMass;   //gramm
+  double PlateMass;       //gramm
+  double InFlightMass;    //gramm, left the container but not yet on the plate
+  double CommandedAngle;  //degree
+  double Angle;           //degree, follows the commanded angle with limited servo speed
+  bool Jammed;            //flap blocked, nothing flows even when open
+  unsigned long LastUpdate;
+  unsigned long Conversions;  //readings of both load cells
+};
+
+extern SimulatedPlant simulatedPlant;
+
+void resetSimulatedPlant(double containerMass, double plateMass);
+void updateSimulatedPlant(unsigned long now);
+long readSimulatedRaw(Scale scale, ScaleRate rate);
+
+class SimulatedScale {
+public:
+  SimulatedScale(Scale id)
+    : id(id), scaleFactor(1), offset(0), rate(LowRate), waitDebt(0) {}
+
+  bool begin(int doutPin, int sckPin, int ratePin) {
+    return true;
+  }
+  bool isReady() {
+    return true;
+  }
+  double getValue(int samples) {
+    return readAverage(samples) - offset;
+  }
+  void tare(int samples) {
+    offset = readAverage(samples);
+  }
+  void setScale(double factor) {
+    scaleFactor = factor;
+  }
+  double getScale() {
+    return scaleFactor;
+  }
+  void setOffset(long newOffset) {
+    offset = newOffset;
+  }
+  long getOffset() {
+    return offset;
+  }
+  void setRate(ScaleRate newRate) {
+    rate = newRate;
+  }
+  ScaleRate getRate() {
+    return rate;
+  }
+
+private:
+  double readAverage(int samples) {
+    double sum = 0;
+    for (int i = 0; i < samples; i++) {
+      //wait for the conversion like the HX711 would, the remainder below 1 ms is carried to the next one
+      waitDebt += rate == HighRate ? SIM_CONVERSION_TIME_HIGH : SIM_CONVERSION_TIME_LOW;
+      delay(waitDebt / 1000);
+      waitDebt %= 1000;
+      sum += readSimulatedRaw(id, rate);
+    }
+    return sum / samples;
+  }
+
+  Scale id;
+  double scaleFactor;
+  long offset;
+  ScaleRate rate;
+  long waitDebt;  //µs
+};
+
+class SimulatedActuator {
+public:
+  void attach(int pin) {}
+  void detach() {}
+  void write(int angle) {
+    updateSimulatedPlant(millis());
+    simulatedPlant.CommandedAngle = angle;
+  }
+};
+
+#endif
+
+#endif
@@ -0,0 +1,92 @@
+#include "SlopeEstimator.h"
+
+const long SLOPE_REBASE_TIME = 60000;  //ms
+
+SlopeEstimator::SlopeEstimator() {
+  reset();
+}
+
+void SlopeEstimator::reset() {
+  first = 0;
+  count = 0;
+  base = 0;
+  sumT = 0;
+  sumV = 0;
+  sumTT = 0;
+  sumTV = 0;
+}
+
+void SlopeEstimator::add(int64_t timestampMS, double value) {
+  if (count > 0) {
+    const int64_t latest = timestamps[(first + count - 1) % SLOPE_WINDOW_SIZE];
+    if (timestampMS < latest) {
+      //clock was stepped back, old readings are useless now
+      reset();
+    }
+  }
+
+  if (count == 0) {
+    base = timestampMS;
+  } else if (timestampMS - base > SLOPE_REBASE_TIME) {
+    rebase(timestampMS);
+  }
+
+  while (count > 0 && (count == SLOPE_WINDOW_SIZE || timestampMS - timestamps[first] > SLOPE_WINDOW_TIME)) {
+    remove();
+  }
+
+  const int index = (first + count) % SLOPE_WINDOW_SIZE;
+  timestamps[index] = timestampMS;
+  values[index] = value;
+  count++;
+
+  const double t = (double)(timestampMS - base) / 1000;
+  sumT += t;
+  sumV += value;
+  sumTT += t * t;
+  sumTV += t * value;
+}
+
+double SlopeEstimator::getSlope() {
+  if (count < 2) {
+    return 0;
+  }
+
+  const double varT = sumTT - sumT * sumT / count;
+  if (varT <= 0) {
+    return 0;
+  }
+  return (sumTV - sumT * sumV / count) / varT;
+}
+
+int SlopeEstimator::getCount() {
+  return count;
+}
+
+void SlopeEstimator::remove() {
+  const double t = (double)(timestamps[first] - base) / 1000;
+  const double value = values[first];
+  sumT -= t;
+  sumV -= value;
+  sumTT -= t * t;
+  sumTV -= t * value;
+  first = (first + 1) % SLOPE_WINDOW_SIZE;
+  count--;
+}
+
+void SlopeEstimator::rebase(int64_t timestampMS) {
+  //recalculate the sums relative to the new base, happens once per SLOPE_REBASE_TIME
+  base = timestampMS;
+  sumT = 0;
+  sumV = 0;
+  sumTT = 0;
+  sumTV = 0;
+  for (int i = 0; i < count; i++) {
+    const int index = (first + i) % SLOPE_WINDOW_SIZE;
+    const double t = (double)(timestamps[index] - base) / 1000;
+    sumT += t;
+    sumV += values[index];
+    sumTT += t * t;
+    sumTV += t * values[index];
+  }
+}
@@ -0,0 +1,34 @@
+#ifndef SLOPEESTIMATOR_H
+#define SLOPEESTIMATOR_H
+
+#include <stdint.h>
+
+//Least squares slope of the latest scale readings in a sliding window.
+//The window is limited by SLOPE_WINDOW_SIZE readings and SLOPE_WINDOW_TIME, every update is O(1).
+const int SLOPE_WINDOW_SIZE = 16;
+const long SLOPE_WINDOW_TIME = 4000;  //ms
+
+class SlopeEstimator {
+public:
+  SlopeEstimator();
+  void reset();
+  void add(int64_t timestampMS, double value);
+  double getSlope();  //per second
+  int getCount();
+
+private:
+  void remove();
+  void rebase(int64_t timestampMS);
+
+  int64_t timestamps[SLOPE_WINDOW_SIZE];
+  double values[SLOPE_WINDOW_SIZE];
+  int first;
+  int count;
+  int64_t base;  //ms, times in the sums are relative to this to keep them small
+  double sumT;
+  double sumV;
+  double sumTT;
+  double sumTV;
+};
+
+#endif
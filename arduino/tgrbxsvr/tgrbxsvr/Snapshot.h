@@ -0,0 +1,132 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <atomic>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include <freertos/task.h>
+
+//Readers of published snapshots, one slot per task
+enum SnapshotReader {
+  NetworkReader,  //async webserver handlers
+  SamplerReader,  //scale sampler task
+  NUM_SNAPSHOT_READERS
+};
+
+const int SNAPSHOT_MAX_RETIRED = 4;
+
+//Immutable snapshot publishing with epoch based reclamation (RCU style).
+//A single writer publishes a new version with an atomic pointer swap, the old version is retired with the
+//epoch of the swap and deleted once no reader entered before that epoch is still inside its read section.
+//Reads are lock free and allocation free: store the current epoch in the reader slot, load the pointer.
+//The writer reads its own pointer without a guard, only the writer deletes.
+template<typename T>
+class Snapshot {
+public:
+  Snapshot()
+    : current(nullptr), epoch(1), retiredCount(0) {
+    for (int i = 0; i < NUM_SNAPSHOT_READERS; i++) {
+      readerEpochs[i].store(0);
+    }
+  }
+
+  //-- reader side, no nesting per slot --//
+  const T* acquire(SnapshotReader reader) {
+    readerEpochs[reader].store(epoch.load());
+    return current.load();
+  }
+
+  void release(SnapshotReader reader) {
+    readerEpochs[reader].store(0);
+  }
+
+  //-- writer side --//
+  T* get() const {
+    return current.load(std::memory_order_relaxed);
+  }
+
+  //takes ownership of value, the previous version is deleted after the grace period
+  void publish(T* value) {
+    T* previous = current.exchange(value);
+    const uint32_t retireEpoch = epoch.fetch_add(1) + 1;
+    if (previous != nullptr) {
+      //read sections are short, only a burst of updates fills the list
+      while (retiredCount >= SNAPSHOT_MAX_RETIRED) {
+        reclaim();
+        if (retiredCount >= SNAPSHOT_MAX_RETIRED) {
+          vTaskDelay(1);
+        }
+      }
+      retired[retiredCount].Value = previous;
+      retired[retiredCount].Epoch = retireEpoch;
+      retiredCount++;
+    }
+    reclaim();
+  }
+
+  //deletes the retired versions no reader can hold anymore, called by the writer every iteration
+  void reclaim() {
+    if (retiredCount == 0) {
+      return;
+    }
+    uint32_t oldest = epoch.load();
+    for (int i = 0; i < NUM_SNAPSHOT_READERS; i++) {
+      const uint32_t readerEpoch = readerEpochs[i].load();
+      if (readerEpoch != 0 && readerEpoch < oldest) {
+        oldest = readerEpoch;
+      }
+    }
+
+    int kept = 0;
+    for (int i = 0; i < retiredCount; i++) {
+      if (retired[i].Epoch <= oldest) {
+        delete retired[i].Value;
+      } else {
+        retired[kept++] = retired[i];
+      }
+    }
+    retiredCount = kept;
+  }
+
+private:
+  struct Retired {
+    T* Value;
+    uint32_t Epoch;
+  };
+
+  std::atomic<T*> current;
+  std::atomic<uint32_t> epoch;
+  std::atomic<uint32_t> readerEpochs[NUM_SNAPSHOT_READERS];  //0 = not reading
+  Retired retired[SNAPSHOT_MAX_RETIRED];  //writer only
+  int retiredCount;
+};
+
+//Read section for one reader slot, the snapshot stays valid until the guard goes out of scope
+template<typename T>
+class SnapshotGuard {
+public:
+  SnapshotGuard(Snapshot<T>& snapshot, SnapshotReader reader)
+    : snapshot(snapshot), reader(reader), value(snapshot.acquire(reader)) {}
+
+  ~SnapshotGuard() {
+    snapshot.release(reader);
+  }
+
+  SnapshotGuard(const SnapshotGuard&) = delete;
+  SnapshotGuard& operator=(const SnapshotGuard&) = delete;
+
+  const T* get() const {
+    return value;
+  }
+
+  const T* operator->() const {
+    return value;
+  }
+
+private:
+  Snapshot<T>& snapshot;
+  SnapshotReader reader;
+  const T* value;
+};
+
+#endif
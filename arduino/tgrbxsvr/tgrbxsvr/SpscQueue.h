@@ -0,0 +1,48 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+
+//Lock free ring buffer for exactly one producer task and one consumer task, e.g. across the two cores.
+//Neither side ever blocks, push fails if the queue is full. Holds up to N - 1 elements, T has to be trivially copyable.
+template<typename T, size_t N>
+class SpscQueue {
+public:
+  SpscQueue()
+    : head(0), tail(0) {}
+
+  //producer only
+  bool push(const T& item) {
+    const size_t currentTail = tail.load(std::memory_order_relaxed);
+    const size_t nextTail = (currentTail + 1) % N;
+    if (nextTail == head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    items[currentTail] = item;
+    tail.store(nextTail, std::memory_order_release);
+    return true;
+  }
+
+  //consumer only
+  bool pop(T& item) {
+    const size_t currentHead = head.load(std::memory_order_relaxed);
+    if (currentHead == tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = items[currentHead];
+    head.store((currentHead + 1) % N, std::memory_order_release);
+    return true;
+  }
+
+  bool isEmpty() const {
+    return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+  }
+
+private:
+  T items[N];
+  std::atomic<size_t> head;  //next element to pop, written by the consumer
+  std::atomic<size_t> tail;  //next free slot, written by the producer
+};
+
+#endif
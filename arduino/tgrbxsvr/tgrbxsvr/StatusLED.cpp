@@ -0,0 +1,73 @@
+#include "StatusLED.h"
+#include <Arduino.h>
+
+const uint32_t LED_BASE_FREQUENCY = 1;  //Hz, while steady
+
+void codeTimerCallback(void *arg) {
+  StatusLED *statusLED = (StatusLED *)arg;
+  statusLED->nextCodeStep();
+}
+
+bool StatusLED::init(int pin) {
+  if (ledcSetup(LED_CHANNEL, LED_BASE_FREQUENCY, LED_RESOLUTION) == 0) {
+    Serial.println("Couldn't set up the status LED");
+    return false;
+  }
+  ledcAttachPin(pin, LED_CHANNEL);
+  setDuty(0);
+
+  esp_timer_create_args_t timerArgs = {};
+  timerArgs.callback = codeTimerCallback;
+  timerArgs.arg = this;
+  timerArgs.name = "LEDCode";
+  return esp_timer_create(&timerArgs, &codeTimer) == ESP_OK;
+}
+
+void StatusLED::setPattern(LEDPattern newPattern) {
+  if (pattern.exchange(newPattern) == newPattern) {
+    return;
+  }
+
+  const LEDPatternConfig &config = LED_PATTERNS[newPattern];
+  if (codeTimer != nullptr) {
+    esp_timer_stop(codeTimer);
+  }
+
+  if (config.Flashes > 0) {
+    ledcChangeFrequency(LED_CHANNEL, LED_BASE_FREQUENCY, LED_RESOLUTION);
+    codeStep = 0;
+    nextCodeStep();
+  } else {
+    ledcChangeFrequency(LED_CHANNEL, config.Frequency > 0 ? config.Frequency : LED_BASE_FREQUENCY, LED_RESOLUTION);
+    setDuty(config.Duty);
+  }
+}
+
+LEDPattern StatusLED::getPattern() {
+  return (LEDPattern)pattern.load();
+}
+
+bool StatusLED::isBlinking() {
+  const LEDPatternConfig &config = LED_PATTERNS[pattern.load()];
+  return config.Frequency > 0 && config.Duty > 0 && config.Duty < 100;
+}
+
+//on and off per flash, the off time of the last flash is the pause
+void StatusLED::nextCodeStep() {
+  const LEDPatternConfig &config = LED_PATTERNS[pattern.load()];
+  if (config.Flashes == 0 || codeTimer == nullptr) {
+    //pattern changed meanwhile
+    return;
+  }
+
+  const bool on = codeStep % 2 == 0;
+  const bool last = codeStep == 2 * config.Flashes - 1;
+  setDuty(on ? 100 : 0);
+  codeStep = last ? 0 : codeStep + 1;
+  esp_timer_start_once(codeTimer, (uint64_t)(last ? LED_CODE_PAUSE : LED_CODE_FLASH) * 1000);
+}
+
+void StatusLED::setDuty(uint8_t percent) {
+  const uint32_t maxDuty = (1UL << LED_RESOLUTION) - 1;
+  ledcWrite(LED_CHANNEL, percent >= 100 ? maxDuty : (uint32_t)((uint64_t)maxDuty * percent / 100));
+}
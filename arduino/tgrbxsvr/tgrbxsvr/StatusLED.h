@@ -0,0 +1,61 @@
+#ifndef STATUSLED_H
+#define STATUSLED_H
+
+#include <atomic>
+#include <stdint.h>
+#include <esp_timer.h>
+
+//Status LED driven by the LEDC peripheral. Blink patterns are a slow PWM signal, the hardware toggles the pin
+//without any task or CPU time. Error codes (n flashes, pause) step through their sequence with an esp_timer,
+//a few callbacks per second on the system timer task. Changing the pattern only reconfigures the peripheral.
+
+enum LEDPattern {
+  LEDOff,
+  LEDReady,
+  LEDPending,
+  LEDFeeding,
+  LEDErrorMotor,
+  LEDErrorStorage,
+  LEDErrorSystem,  //a task or timer could not be created at startup
+  NUM_LED_PATTERNS
+};
+
+struct LEDPatternConfig {
+  uint32_t Frequency;  //Hz, blink frequency, 0 = steady
+  uint8_t Duty;        //percent on
+  uint8_t Flashes;     //error code, flashes before the pause, 0 = no code
+};
+
+const LEDPatternConfig LED_PATTERNS[NUM_LED_PATTERNS] = {
+  { 0, 0, 0 },    //LEDOff
+  { 0, 100, 0 },  //LEDReady
+  { 1, 50, 0 },   //LEDPending
+  { 4, 50, 0 },   //LEDFeeding
+  { 0, 0, 2 },    //LEDErrorMotor
+  { 0, 0, 3 },    //LEDErrorStorage
+  { 0, 0, 4 },    //LEDErrorSystem
+};
+
+const int LED_CHANNEL = 15;     //last channel, the servo library allocates from 0
+const int LED_RESOLUTION = 20;  //bits, needed for blink frequencies down to 1 Hz
+const uint32_t LED_CODE_FLASH = 200;  //ms, on and off time of an error code flash
+const uint32_t LED_CODE_PAUSE = 1500;  //ms, after the last flash
+
+class StatusLED {
+public:
+  bool init(int pin);
+  void setPattern(LEDPattern pattern);
+  LEDPattern getPattern();
+  bool isBlinking();  //the LEDC channel has to keep running, a steady level or a code step holds in light sleep
+
+  void nextCodeStep();  //esp_timer callback only
+
+private:
+  void setDuty(uint8_t percent);
+
+  std::atomic<int> pattern{ LEDOff };
+  int codeStep = 0;
+  esp_timer_handle_t codeTimer = nullptr;
+};
+
+#endif
@@ -0,0 +1,149 @@
+#include "TimeService.h"
+#include "freertos/FreeRTOS.h"
+#include <freertos/task.h>
+#include <esp_timer.h>
+#include <Arduino.h>
+
+const char *NTP_SERVER = "pool.ntp.org";
+const int NTP_PORT = 123;
+const int NTP_LOCAL_PORT = 1337;
+const int NTP_PACKET_SIZE = 48;
+const int64_t NTP_TIMEOUT = 1000000;        //µs
+const int64_t NTP_UNIX_OFFSET = 2208988800LL;  //s from 1900 to 1970
+
+const int TIME_SYNC_CORE = 0;
+const int TIME_SYNC_PRIORITY = 1;
+const int64_t MS_PER_DAY_64 = 86400000LL;
+
+void timeSyncTask(void *pvParameters) {
+  TimeService *timeService = (TimeService *)pvParameters;
+  for (;;) {
+    const int64_t wait = timeService->resync() ? TIME_RESYNC_INTERVAL : TIME_RETRY_INTERVAL;
+    vTaskDelay(pdMS_TO_TICKS(wait / 1000));
+  }
+}
+
+bool TimeService::begin() {
+  udp.begin(NTP_LOCAL_PORT);
+  while (!resync()) {
+    Serial.println("Couldn't fetch time via NTP...");
+    delay(4000);
+  }
+  return xTaskCreatePinnedToCore(timeSyncTask, "TimeSync", 4096, this, TIME_SYNC_PRIORITY, NULL, TIME_SYNC_CORE) == pdPASS;
+}
+
+bool TimeService::isSynced() {
+  return timeBase.read().Syncs > 0;
+}
+
+int64_t TimeService::getMonotonicMicros() {
+  return esp_timer_get_time();
+}
+
+int64_t TimeService::getUnixMicros() {
+  return toUnix(timeBase.read(), esp_timer_get_time());
+}
+
+int64_t TimeService::getUnixMillis() {
+  return getUnixMicros() / 1000;
+}
+
+long TimeService::getUnixTime() {
+  return getUnixMicros() / 1000000;
+}
+
+long TimeService::getDay() {
+  return getUnixMillis() / MS_PER_DAY_64;
+}
+
+long TimeService::getDaytime() {
+  return getUnixMillis() % MS_PER_DAY_64;
+}
+
+TimeBase TimeService::getTimeBase() {
+  return timeBase.read();
+}
+
+int64_t TimeService::toUnix(const TimeBase &base, int64_t monotonicMicros) {
+  const int64_t elapsed = monotonicMicros - base.Monotonic;
+  const int64_t slewed = (monotonicMicros < base.SlewEnd ? monotonicMicros : base.SlewEnd) - base.Monotonic;
+  return base.Unix + elapsed + slewed * base.SlewRate / 1000000;
+}
+
+bool TimeService::resync() {
+  int64_t unixMicros;
+  int64_t monotonicMicros;
+  if (!requestTime(unixMicros, monotonicMicros)) {
+    return false;
+  }
+  adjust(unixMicros, monotonicMicros);
+  return true;
+}
+
+//one SNTP exchange, only this task waits for the answer
+bool TimeService::requestTime(int64_t &unixMicros, int64_t &monotonicMicros) {
+  uint8_t packet[NTP_PACKET_SIZE] = {};
+  packet[0] = 0x1B;  //no leap warning, version 3, client
+
+  //drop late answers of an earlier request
+  while (udp.parsePacket() > 0) {
+    udp.flush();
+  }
+
+  const int64_t sent = esp_timer_get_time();
+  if (!udp.beginPacket(NTP_SERVER, NTP_PORT)) {
+    return false;
+  }
+  udp.write(packet, NTP_PACKET_SIZE);
+  if (!udp.endPacket()) {
+    return false;
+  }
+
+  while (udp.parsePacket() < NTP_PACKET_SIZE) {
+    if (esp_timer_get_time() - sent > NTP_TIMEOUT) {
+      return false;
+    }
+    vTaskDelay(1);
+  }
+  const int64_t received = esp_timer_get_time();
+  udp.read(packet, NTP_PACKET_SIZE);
+
+  //transmit timestamp, seconds since 1900 and 32 bit fraction
+  const uint32_t seconds = (uint32_t)packet[40] << 24 | (uint32_t)packet[41] << 16 | (uint32_t)packet[42] << 8 | packet[43];
+  const uint32_t fraction = (uint32_t)packet[44] << 24 | (uint32_t)packet[45] << 16 | (uint32_t)packet[46] << 8 | packet[47];
+  if (seconds == 0) {
+    return false;
+  }
+
+  unixMicros = ((int64_t)seconds - NTP_UNIX_OFFSET) * 1000000 + (int64_t)(((uint64_t)fraction * 1000000) >> 32);
+  //the server time belongs to the middle of the round trip
+  monotonicMicros = sent + (received - sent) / 2;
+  return true;
+}
+
+void TimeService::adjust(int64_t unixMicros, int64_t monotonicMicros) {
+  const TimeBase current = timeBase.read();
+  const int64_t local = toUnix(current, monotonicMicros);
+  const int64_t offset = unixMicros - local;
+
+  TimeBase updated = current;
+  updated.Monotonic = monotonicMicros;
+  updated.LastOffset = offset;
+  updated.Syncs = current.Syncs + 1;
+
+  if (current.Syncs == 0 || offset > TIME_STEP_THRESHOLD || offset < -TIME_STEP_THRESHOLD) {
+    updated.Unix = unixMicros;
+    updated.SlewRate = 0;
+    updated.SlewEnd = monotonicMicros;
+    Serial.print("Time stepped by (ms): ");
+    Serial.println((long)(offset / 1000));
+  } else {
+    //continue from the local time and run faster or slower until the offset is gone
+    const int64_t magnitude = offset < 0 ? -offset : offset;
+    updated.Unix = local;
+    updated.SlewRate = offset < 0 ? -TIME_MAX_SLEW : TIME_MAX_SLEW;
+    updated.SlewEnd = monotonicMicros + magnitude * 1000000 / TIME_MAX_SLEW;
+  }
+
+  timeBase.write(updated);
+}
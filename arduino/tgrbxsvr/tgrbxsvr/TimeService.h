@@ -0,0 +1,54 @@
+#ifndef TIMESERVICE_H
+#define TIMESERVICE_H
+
+#include <stdint.h>
+#include <WiFiUdp.h>
+#include "SeqLock.h"
+
+//Wall clock of the firmware.
+//The 64 bit µs timer (esp_timer, does not wrap) is mapped to unix time, the mapping is published with a SeqLock,
+//so all queries are lock free and cheap from any task. A resync task on the network core asks an NTP server
+//every TIME_RESYNC_INTERVAL. Offsets up to TIME_STEP_THRESHOLD are slewed with at most TIME_MAX_SLEW, the clock
+//never jumps and never runs backwards then. Larger offsets (first sync, long outage) are stepped.
+//All days and daytimes are UTC.
+
+const int64_t TIME_RESYNC_INTERVAL = 3600LL * 1000000;  //µs
+const int64_t TIME_RETRY_INTERVAL = 60LL * 1000000;     //µs, after a failed resync
+const int64_t TIME_STEP_THRESHOLD = 10LL * 1000000;     //µs
+const int32_t TIME_MAX_SLEW = 500;                      //ppm, 1 s offset takes 2000 s
+
+//unix time = Unix + (monotonic - Monotonic) + slew correction until SlewEnd
+struct TimeBase {
+  int64_t Monotonic;  //µs, esp_timer at the anchor
+  int64_t Unix;       //µs, unix time at the anchor
+  int32_t SlewRate;   //ppm
+  int64_t SlewEnd;    //µs, esp_timer
+  int64_t LastOffset; //µs, measured at the last sync
+  uint32_t Syncs;     //0 = never synced
+};
+
+class TimeService {
+public:
+  bool begin();  //blocks until the first sync, then starts the resync task
+  bool isSynced();
+
+  int64_t getMonotonicMicros();
+  int64_t getUnixMicros();
+  int64_t getUnixMillis();
+  long getUnixTime();  //s
+  long getDay();       //days since 1970-01-01
+  long getDaytime();   //ms since midnight
+  TimeBase getTimeBase();
+
+  bool resync();  //resync task only
+
+private:
+  bool requestTime(int64_t& unixMicros, int64_t& monotonicMicros);
+  void adjust(int64_t unixMicros, int64_t monotonicMicros);
+  static int64_t toUnix(const TimeBase& base, int64_t monotonicMicros);
+
+  SeqLock<TimeBase> timeBase;
+  WiFiUDP udp;
+};
+
+#endif
@@ -0,0 +1,232 @@
+#include "TimerService.h"
+#include <freertos/task.h>
+#include <esp_timer.h>
+#include <stddef.h>
+
+const int TIMER_CORE = 1;
+const int TIMER_PRIORITY = 2;
+const uint64_t TIMER_MAX_DELTA = (1ULL << (TIMER_ROOT_BITS + (TIMER_LEVELS - 1) * TIMER_LEVEL_BITS)) - 1;  //ticks
+
+void timerTask(void *pvParameters) {
+  TimerService *timerService = (TimerService *)pvParameters;
+  timerService->run();
+  vTaskDelete(NULL);
+}
+
+TimerService::TimerService()
+  : timerCount(0), scheduledCount(0), currentTick(0), worker(nullptr) {
+  lock = portMUX_INITIALIZER_UNLOCKED;
+  for (int i = 0; i < TIMER_SLOTS; i++) {
+    slots[i] = -1;
+  }
+  for (int i = 0; i < TIMER_ROOT_SLOTS / 32; i++) {
+    occupied[i] = 0;
+  }
+}
+
+bool TimerService::start() {
+  currentTick = getNow();
+  return xTaskCreatePinnedToCore(timerTask, "Timers", 3072, this, TIMER_PRIORITY, &worker, TIMER_CORE) == pdPASS;
+}
+
+int TimerService::create(TimerCallback callback, void *arg) {
+  portENTER_CRITICAL(&lock);
+  if (timerCount >= TIMER_MAX_TIMERS) {
+    portEXIT_CRITICAL(&lock);
+    return -1;
+  }
+  const int timer = timerCount++;
+  timers[timer].Callback = callback;
+  timers[timer].Arg = arg;
+  timers[timer].Slot = -1;
+  portEXIT_CRITICAL(&lock);
+  return timer;
+}
+
+void TimerService::schedule(int timer, uint32_t delayMS, uint32_t periodMS) {
+  //a failed create() returns -1, the caller reported it already
+  if (timer < 0 || timer >= TIMER_MAX_TIMERS) {
+    return;
+  }
+  const uint64_t now = getNow();
+  portENTER_CRITICAL(&lock);
+  Timer &entry = timers[timer];
+  if (entry.Slot >= 0) {
+    remove(timer);
+  }
+  entry.Expires = now + (delayMS + TIMER_TICK - 1) / TIMER_TICK;
+  entry.Period = periodMS > 0 ? (periodMS + TIMER_TICK - 1) / TIMER_TICK : 0;
+  if (scheduledCount == 0 && currentTick < now) {
+    //the idle worker does not keep the tick, catch up
+    currentTick = now;
+  }
+  //the worker may not have processed the ticks up to now yet
+  if (entry.Expires < currentTick) {
+    entry.Expires = currentTick;
+  }
+  add(timer);
+  portEXIT_CRITICAL(&lock);
+
+  if (worker != nullptr) {
+    xTaskNotifyGive(worker);
+  }
+}
+
+void TimerService::cancel(int timer) {
+  if (timer < 0 || timer >= TIMER_MAX_TIMERS) {
+    return;
+  }
+  portENTER_CRITICAL(&lock);
+  if (timers[timer].Slot >= 0) {
+    remove(timer);
+  }
+  portEXIT_CRITICAL(&lock);
+}
+
+bool TimerService::isScheduled(int timer) {
+  portENTER_CRITICAL(&lock);
+  const bool scheduled = timers[timer].Slot >= 0;
+  portEXIT_CRITICAL(&lock);
+  return scheduled;
+}
+
+void TimerService::run() {
+  TimerCallback callbacks[TIMER_MAX_TIMERS];
+  void *args[TIMER_MAX_TIMERS];
+
+  while (true) {
+    const uint64_t now = getNow();
+    portENTER_CRITICAL(&lock);
+    uint64_t next = getNextEvent();
+    while (next <= now) {
+      //nothing is due between currentTick and next
+      currentTick = next;
+      const int count = expire(callbacks, args);
+      portEXIT_CRITICAL(&lock);
+      for (int i = 0; i < count; i++) {
+        callbacks[i](args[i]);
+      }
+      portENTER_CRITICAL(&lock);
+      next = getNextEvent();
+    }
+    const bool idle = scheduledCount == 0;
+    portEXIT_CRITICAL(&lock);
+
+    //woken early by schedule()
+    ulTaskNotifyTake(pdTRUE, idle ? portMAX_DELAY : pdMS_TO_TICKS((next - now) * TIMER_TICK));
+  }
+}
+
+uint64_t TimerService::getNow() {
+  return esp_timer_get_time() / 1000 / TIMER_TICK;
+}
+
+void TimerService::add(int timer) {
+  Timer &entry = timers[timer];
+  uint64_t delta = entry.Expires - currentTick;
+  if (delta > TIMER_MAX_DELTA) {
+    delta = TIMER_MAX_DELTA;
+    entry.Expires = currentTick + delta;
+  }
+
+  int slot;
+  if (delta < TIMER_ROOT_SLOTS) {
+    slot = entry.Expires & (TIMER_ROOT_SLOTS - 1);
+    occupied[slot / 32] |= 1u << (slot % 32);
+  } else {
+    int level = 1;
+    while (delta >= 1ULL << (TIMER_ROOT_BITS + level * TIMER_LEVEL_BITS)) {
+      level++;
+    }
+    const int shift = TIMER_ROOT_BITS + (level - 1) * TIMER_LEVEL_BITS;
+    slot = TIMER_ROOT_SLOTS + (level - 1) * TIMER_LEVEL_SLOTS + ((entry.Expires >> shift) & (TIMER_LEVEL_SLOTS - 1));
+  }
+
+  entry.Slot = slot;
+  entry.Prev = -1;
+  entry.Next = slots[slot];
+  if (entry.Next >= 0) {
+    timers[entry.Next].Prev = timer;
+  }
+  slots[slot] = timer;
+  scheduledCount++;
+}
+
+void TimerService::remove(int timer) {
+  Timer &entry = timers[timer];
+  if (entry.Prev >= 0) {
+    timers[entry.Prev].Next = entry.Next;
+  } else {
+    slots[entry.Slot] = entry.Next;
+  }
+  if (entry.Next >= 0) {
+    timers[entry.Next].Prev = entry.Prev;
+  }
+  if (entry.Slot < TIMER_ROOT_SLOTS && slots[entry.Slot] < 0) {
+    occupied[entry.Slot / 32] &= ~(1u << (entry.Slot % 32));
+  }
+  entry.Slot = -1;
+  scheduledCount--;
+}
+
+//moves the timers of an upper level slot down, they expire within the range of the level below now
+void TimerService::cascade(int level, int index) {
+  int timer = slots[TIMER_ROOT_SLOTS + (level - 1) * TIMER_LEVEL_SLOTS + index];
+  while (timer >= 0) {
+    const int next = timers[timer].Next;
+    remove(timer);
+    add(timer);
+    timer = next;
+  }
+}
+
+//first tick from currentTick on with an occupied lowest level slot or a cascade
+uint64_t TimerService::getNextEvent() {
+  const int index = currentTick & (TIMER_ROOT_SLOTS - 1);
+  if (index == 0) {
+    return currentTick;
+  }
+  for (int word = index / 32; word < TIMER_ROOT_SLOTS / 32; word++) {
+    uint32_t bits = occupied[word];
+    if (word == index / 32) {
+      bits &= ~0u << (index % 32);
+    }
+    if (bits != 0) {
+      return currentTick - index + word * 32 + __builtin_ctz(bits);
+    }
+  }
+  return currentTick - index + TIMER_ROOT_SLOTS;
+}
+
+//processes currentTick, returns the callbacks to run
+int TimerService::expire(TimerCallback *callbacks, void **args) {
+  const int index = currentTick & (TIMER_ROOT_SLOTS - 1);
+  if (index == 0) {
+    for (int level = 1; level < TIMER_LEVELS; level++) {
+      const int levelIndex = (currentTick >> (TIMER_ROOT_BITS + (level - 1) * TIMER_LEVEL_BITS)) & (TIMER_LEVEL_SLOTS - 1);
+      cascade(level, levelIndex);
+      if (levelIndex != 0) {
+        break;
+      }
+    }
+  }
+
+  int count = 0;
+  int timer = slots[index];
+  while (timer >= 0) {
+    Timer &entry = timers[timer];
+    const int next = entry.Next;
+    remove(timer);
+    callbacks[count] = entry.Callback;
+    args[count] = entry.Arg;
+    count++;
+    if (entry.Period > 0) {
+      entry.Expires = currentTick + entry.Period;
+      add(timer);
+    }
+    timer = next;
+  }
+
+  currentTick++;
+  return count;
+}
@@ -0,0 +1,63 @@
+#ifndef TIMERSERVICE_H
+#define TIMERSERVICE_H
+
+#include "freertos/FreeRTOS.h"
+#include <stdint.h>
+
+//One shot and periodic software timers on a hierarchical timer wheel, all callbacks run on one worker task.
+//Levels: 256 slots of one tick, then 3 x 64 slots of 256, 16384 and 1048576 ticks (up to ~7.7 days).
+//Starting and stopping is O(1) from any task, timers of the upper levels cascade down when their slot is reached.
+//The worker sleeps until the next occupied slot of the lowest level or the next cascade, not every tick.
+//Timers are created once from a fixed pool, callbacks have to be short and must not block.
+
+typedef void (*TimerCallback)(void* arg);
+
+const uint32_t TIMER_TICK = 10;  //ms
+const int TIMER_MAX_TIMERS = 16;
+const int TIMER_LEVELS = 4;
+const int TIMER_ROOT_BITS = 8;
+const int TIMER_LEVEL_BITS = 6;
+const int TIMER_ROOT_SLOTS = 1 << TIMER_ROOT_BITS;
+const int TIMER_LEVEL_SLOTS = 1 << TIMER_LEVEL_BITS;
+const int TIMER_SLOTS = TIMER_ROOT_SLOTS + (TIMER_LEVELS - 1) * TIMER_LEVEL_SLOTS;
+
+class TimerService {
+public:
+  TimerService();
+  bool start();  //starts the worker
+  int create(TimerCallback callback, void* arg);  //timer ID, -1 if the pool is used up
+  void schedule(int timer, uint32_t delayMS, uint32_t periodMS = 0);  //(re)starts, period 0 = one shot
+  void cancel(int timer);
+  bool isScheduled(int timer);
+
+  void run();  //worker task only
+
+private:
+  struct Timer {
+    TimerCallback Callback;
+    void* Arg;
+    uint64_t Expires;  //tick
+    uint32_t Period;   //ticks, 0 = one shot
+    int Slot;          //-1 = not scheduled
+    int Next;
+    int Prev;
+  };
+
+  uint64_t getNow();
+  void add(int timer);
+  void remove(int timer);
+  void cascade(int level, int index);
+  uint64_t getNextEvent();
+  int expire(TimerCallback* callbacks, void** args);
+
+  Timer timers[TIMER_MAX_TIMERS];
+  int timerCount;
+  int scheduledCount;
+  int slots[TIMER_SLOTS];  //first timer per slot, -1 = empty
+  uint32_t occupied[TIMER_ROOT_SLOTS / 32];  //bitmap of the non empty lowest level slots
+  uint64_t currentTick;  //next tick to process
+  portMUX_TYPE lock;
+  TaskHandle_t worker;
+};
+
+#endif
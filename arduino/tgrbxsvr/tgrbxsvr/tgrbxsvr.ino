@@ -1,183 +1,283 @@
 #include "freertos/FreeRTOS.h"
 #include <freertos/task.h>
 #include <freertos/projdefs.h>
+#include <freertos/event_groups.h>
 #include <stdlib.h>
 #include <vector>
+#include <atomic>
 #include <algorithm>
 #include <ArduinoJson.h>
 #include "JsonHelper.h"
 #include "DataAccess.h"
 #include "MachineController.h"
 #include "NetworkController.h"
+#include "SlopeEstimator.h"
+#include "ScaleCalibration.h"
+#include "FeedController.h"
+#include "MotorSupervisor.h"
+#include "SeqLock.h"
+#include "SpscQueue.h"
+#include "Snapshot.h"
+#include "FeedTimeTable.h"
+#include "CalendarSchedule.h"
+#include "FeedWindow.h"
+#include "LoopGovernor.h"
+#include "PowerManager.h"
+#include "TimeService.h"
+#include "TimerService.h"
+#include "StatusLED.h"
 #include "Models.h"
 
-const double WEIGHT_D_THRESHOLD = 2;  //in gramm/second
-const double SAFETY_WEIGHT_GAP = 2;   //in gramm, start closing a bit earlier to include container closing time
-const double CONTAINER_EMPTY_THRESHOLD = 2;
 const double NO_CONTAINER_THRESHOLD = -10;  //negative, since empty container = tar weight
 const double PLATE_EMPTY_THRESHOLD = 2;
 
-const double LOOP_FREQ_NORMAL = 0.5;
-const double LOOP_FREQ_FAST = 50;
-const double COOLDOWN_TIME = 5;  //seconds
+const int64_t FEED_MAX_POSTPONE = 600000;   //ms, a due feed waits this long for a running calibration, then it is skipped
+int64_t feedPostponedSince = 0;             //unix ms, 0 = no feed postponed
 
-double CURRENT_LOOP_FREQ = LOOP_FREQ_NORMAL;
-long noStatusChangeTimestamp = 0;
+LoopGovernor loopGovernor;
+double CURRENT_LOOP_FREQ = LOOP_TIERS[IdleTier].Frequency;  //sampling frequency, the loop runs once per new sample
 
-Schedule* selectedSchedule = nullptr;
+//Schedule and user settings are immutable once published. The loop is the only writer and uses its own
+//pointers below, other tasks read the snapshots inside a SnapshotGuard
+Snapshot<Schedule> scheduleSnapshot;
+Snapshot<UserSettings> userSettingsSnapshot;
+Schedule* selectedSchedule = nullptr;  //loop view of scheduleSnapshot
 SystemSettings* systemSettings = nullptr;
-UserSettings* userSettings = nullptr;
+UserSettings* userSettings = nullptr;  //loop view of userSettingsSnapshot
 Config* config = nullptr;
 
-MachineStatus* previousStatus = nullptr;
-MachineStatus* currentStatus = nullptr;
+//double buffered, the buffers are swapped every loop instead of allocating a new status.
+//Only the control loop touches them, other tasks read the published snapshot
+MachineStatus statusBuffers[2];
+MachineStatus* previousStatus = &statusBuffers[0];
+MachineStatus* currentStatus = &statusBuffers[1];
+SeqLock<MachineStatus> publishedStatus;
+
+//Control, sampling and storage run on core 1, the network on core 0 (see build_opt.h).
+//The network task only hands commands to the loop, status and events go back through the NetworkController queues
+const int COMMAND_QUEUE_LENGTH = 16;
+SpscQueue<Command, COMMAND_QUEUE_LENGTH> commandQueue;
+int nextCommandID = 1;  //network task only
+CommandMetrics commandMetrics = {};
+SeqLock<CommandMetrics> publishedCommandMetrics;
 
 DataAccess dataAccess;
 MachineController machineController;
 NetworkController networkController;
+ScaleCalibration scaleCalibration;
+TimeService timeService;
+TimerService timerService;  //delayed and periodic work, one worker task
+PowerManager powerManager;
 
-long previousTimestamp = 0;  //daytime in ms
-long currentTimestamp = 0;   //daytime in ms
+int64_t previousTimestamp = 0;  //unix in ms
+int64_t currentTimestamp = 0;   //unix in ms, from the 64 bit disciplined clock, does not wrap
 
 long lastFedTimestamp = 0;  //unix in s
 int numTimesFedToday = 0;
 
-double currentFeedTargetWeight = 0;
+//compiled daytimes of the selected schedule
+FeedTimeTable feedTimeTable;
+CalendarSchedule calendarSchedule;
+int64_t calendarNextDayFire = -1;  //ms after midnight of the loaded calendar day until the first feed of a later day, -1 for none
+FeedWindow feedWindow;  //MaxTimes eligibility
+
+FeedController feedController;
+
+SlopeEstimator containerSlope;
+SlopeEstimator plateSlope;
 
 const int MAX_HISTORY_BUFFER = 100;
 std::vector<ScaleData> containerScaleHistoryBuffer;
 std::vector<ScaleData> plateScaleHistoryBuffer;
 
-Schedule* historySchedule = nullptr;
-std::vector<Event> eventHistoryBuffer;
+MotorSupervisor motorSupervisor;
+int handledJamCount = 0;
+
+//The control loop blocks until there is work: a new sample, a command or the next feed time.
+//The idle timeout is a safety tick in case the sampler stalls
+const EventBits_t SAMPLE_EVENT = 1 << 0;
+const EventBits_t COMMAND_EVENT = 1 << 1;
+const EventBits_t CONTROL_EVENTS = SAMPLE_EVENT | COMMAND_EVENT;
+const long MAX_IDLE_TIME = 5000;  //ms, wait without a feed time
+const long MAX_FEED_WAIT = 600000;  //ms, longest wait for a feed time, the wait is recomputed afterwards
+EventGroupHandle_t controlEvents = nullptr;
+unsigned long lastSampleSequence = 0;
+
+#ifdef SOAK_TEST
+//Soak test build: counts the heap operations of the loop task and reports them per iteration.
+//The control path is expected to report zero while idle and while feeding
+#include <stdlib.h>
 
-const int MOTOR_CHECK_WAIT = 2;  //seconds
-bool motorOpenCheckRunning = false;
-bool motorCloseCheckRunning = false;
-TaskHandle_t motorOperationCheckHandle;
-TaskHandle_t motorOpenCheckHandle;
-TaskHandle_t motorCloseCheckHandle;
-MotorCheckParams motorCheckParams;
+const unsigned long SOAK_REPORT_INTERVAL = 1000;  //iterations
+TaskHandle_t soakLoopTask = nullptr;
+std::atomic<unsigned long> soakHeapOperations(0);
+unsigned long soakIterations = 0;
 
+void countHeapOperation() {
+  if (soakLoopTask != nullptr && xTaskGetCurrentTaskHandle() == soakLoopTask) {
+    soakHeapOperations++;
+  }
+}
 
-//Status LED
-const int LED_PIN = 22;
-const int LED_PENDING_FREQ = 2;
-TaskHandle_t ledPendingTaskHandle = nullptr;
+void* operator new(size_t size) {
+  countHeapOperation();
+  return malloc(size);
+}
 
-void led_task_statusPending(void* pvParameters) {
-  digitalWrite(LED_PIN, LOW);
-  const double delay = ((double)1) / LED_PENDING_FREQ;
+void* operator new[](size_t size) {
+  countHeapOperation();
+  return malloc(size);
+}
 
-  while (true) {
-    vTaskDelay(pdMS_TO_TICKS(delay * 1000));
-    digitalWrite(LED_PIN, HIGH);
-    vTaskDelay(pdMS_TO_TICKS(delay * 1000));
-    digitalWrite(LED_PIN, LOW);
-  }
+void operator delete(void* ptr) noexcept {
+  countHeapOperation();
+  free(ptr);
+}
 
-  vTaskDelete(NULL);
+void operator delete[](void* ptr) noexcept {
+  countHeapOperation();
+  free(ptr);
 }
 
-void setLEDPending() {
-  if (ledPendingTaskHandle != nullptr && eTaskGetState(ledPendingTaskHandle) != eDeleted) {
-    vTaskDelete(ledPendingTaskHandle);
-  }
+void operator delete(void* ptr, size_t size) noexcept {
+  countHeapOperation();
+  free(ptr);
+}
 
-  xTaskCreatePinnedToCore(led_task_statusPending, "LED_Pend", 4096, NULL, 1, &ledPendingTaskHandle, 1);
+void operator delete[](void* ptr, size_t size) noexcept {
+  countHeapOperation();
+  free(ptr);
 }
 
-void setLEDReady() {
-  if (ledPendingTaskHandle != nullptr && eTaskGetState(ledPendingTaskHandle) != eDeleted) {
-    vTaskDelete(ledPendingTaskHandle);
+void reportSoakTest() {
+  if (soakLoopTask == nullptr) {
+    //the first iterations fill the buffers, counting starts afterwards
+    soakLoopTask = xTaskGetCurrentTaskHandle();
+    soakHeapOperations = 0;
+    return;
+  }
+
+  soakIterations++;
+  if (soakIterations % SOAK_REPORT_INTERVAL != 0) {
+    return;
   }
-  digitalWrite(LED_PIN, HIGH);
+
+  const unsigned long operations = soakHeapOperations.exchange(0);
+  Serial.print("Soak test: ");
+  Serial.print(SOAK_REPORT_INTERVAL);
+  Serial.print(" iterations, ");
+  Serial.print((double)operations / SOAK_REPORT_INTERVAL);
+  Serial.print(" heap operations per iteration, free heap: ");
+  Serial.print(ESP.getFreeHeap());
+  Serial.println(operations == 0 ? " PASS" : " FAIL");
 }
-/*
-void motorOperationCheckTask(void* pvParameters) {
-  vTaskDelay(pdMS_TO_TICKS(MOTOR_CHECK_WAIT * 1000));
+#endif
 
-  const double container_D = currentStatus->ContainerLoad - motorCheckParams.ContainerLoad;
 
-  if (motorCheckParams.Open) {
-    if (container_D / (double)MOTOR_CHECK_WAIT > -1 * WEIGHT_D_THRESHOLD) {
-      currentStatus->MotorOperation = false;
-    } else {
-      currentStatus->MotorOperation = true;
-    }
+//Status LED
+const int LED_PIN = 22;
+StatusLED statusLED;
+bool motorFault = false;  //a feed was aborted by a motor failure, cleared by the next finished feed
+bool storageFault = false;
+bool systemFault = false;  //startup incomplete, a task or timer is missing, needs a fix and a restart
+
+//feeding and errors override ready, the pattern is only reconfigured on a change
+void updateStatusLED() {
+  if (currentStatus->AutomaticFeeding) {
+    statusLED.setPattern(LEDFeeding);
+  } else if (motorFault) {
+    statusLED.setPattern(LEDErrorMotor);
+  } else if (systemFault) {
+    statusLED.setPattern(LEDErrorSystem);
+  } else if (storageFault) {
+    statusLED.setPattern(LEDErrorStorage);
   } else {
-    if (container_D <= -1 * WEIGHT_D_THRESHOLD) {
-      currentStatus->MotorOperation = false;
-    } else {
-      currentStatus->MotorOperation = true;
-    }
+    statusLED.setPattern(LEDReady);
   }
+}
 
-  vTaskDelete(NULL);
-}*/
-
-void motorOpenCheckTask(void* pvParameters) {
-  vTaskDelay(pdMS_TO_TICKS(MOTOR_CHECK_WAIT * 1000));
-
-  if (motorOpenCheckRunning) {
-    const double container_D = currentStatus->ContainerLoad - motorCheckParams.ContainerLoad;
+//Container empty notification, only if the container stays empty (no refill, no short dip while feeding)
+const uint32_t CONTAINER_EMPTY_CONFIRM_TIME = 60000;  //ms
+int containerEmptyTimer = -1;
+std::atomic<bool> containerEmptyCheckDue(false);
 
-    if (container_D / (double)MOTOR_CHECK_WAIT > -1 * WEIGHT_D_THRESHOLD) {
-      currentStatus->MotorOperation = false;
-    } else {
-      currentStatus->MotorOperation = true;
-    }
+//timer worker
+void containerEmptyTimeout(void* arg) {
+  containerEmptyCheckDue = true;
+  notifyControlLoop();
+}
+//commands are sent by the network task only (single producer).
+//Returns the command ID, the result is sent to the websocket clients. 0 if the queue is full
+int sendCommand(Command& command) {
+  command.ID = nextCommandID;
+  command.EnqueuedAt = micros();
+  if (!commandQueue.push(command)) {
+    return 0;
   }
-
-  vTaskDelete(NULL);
+  nextCommandID++;
+  notifyControlLoop();
+  return command.ID;
 }
 
-void motorCloseCheckTask(void* pvParameters) {
-  vTaskDelay(pdMS_TO_TICKS(MOTOR_CHECK_WAIT * 1000));
+bool setSchedule(Schedule* newSchedule) {
+  Command command = {};
+  command.Type = ScheduleCommand;
+  command.NewSchedule = newSchedule;
+  return sendCommand(command) > 0;
+}
 
-  if (motorCloseCheckRunning) {
-    const double container_D = currentStatus->ContainerLoad - motorCheckParams.ContainerLoad;
+bool setUserSettings(UserSettings* newUserSettings) {
+  Command command = {};
+  command.Type = UserSettingsCommand;
+  command.NewUserSettings = newUserSettings;
+  return sendCommand(command) > 0;
+}
 
-    if (container_D <= -1 * WEIGHT_D_THRESHOLD) {
-      currentStatus->MotorOperation = false;
-    } else {
-      currentStatus->MotorOperation = true;
-    }
-  }
+int requestContainer(bool open) {
+  Command command = {};
+  command.Type = ContainerCommand;
+  command.Open = open;
+  return sendCommand(command);
+}
 
-  vTaskDelete(NULL);
+//enqueue to execution latency of the executed commands, safe to call from any task
+CommandMetrics getCommandMetrics() {
+  return publishedCommandMetrics.read();
 }
 
-void setSchedule(Schedule* newSchedule) {
-  delete selectedSchedule;
-  selectedSchedule = newSchedule;
-  historySchedule = new Schedule(*selectedSchedule);
-  historySchedule->CreatedOn = getUnixTimestamp(currentTimestamp);
-  dataAccess.logScheduleHistory(historySchedule);
+//wakes the control loop, e.g. after a command changed the state it works on
+void notifyControlLoop() {
+  if (controlEvents != nullptr) {
+    xEventGroupSetBits(controlEvents, COMMAND_EVENT);
+  }
 }
 
 void setup() {
   Serial.begin(115200);
-  pinMode(LED_PIN, OUTPUT);
-  setLEDPending();
+  controlEvents = xEventGroupCreate();
+  timerService.start();
+  containerEmptyTimer = timerService.create(containerEmptyTimeout, nullptr);
+  if (containerEmptyTimer < 0) {
+    Serial.println("Couldnt create container empty timer, raise TIMER_MAX_TIMERS!");
+    systemFault = true;
+  }
+  statusLED.init(LED_PIN);
+  statusLED.setPattern(LEDPending);
 
-  dataAccess.init();
+  storageFault = !dataAccess.init();
   config = dataAccess.getConfig();
   Serial.println("Loaded Config");
   systemSettings = dataAccess.getSystemSettings();
   Serial.println("Loaded SystemSettings");
-  userSettings = dataAccess.getUserSettings();
+  publishUserSettings(dataAccess.getUserSettings());
   Serial.println("Loaded UserSettings");
 
   networkController.initNetworkConnection(config);
-  networkController.initNTP();
-  currentTimestamp = networkController.getCurrentDaytime();
-  //Serial.print("CurrentTimestamp: ");
-  //Serial.println(std::to_string(currentTimestamp).c_str());
-  //Serial.print("Today: ");
-  //Serial.println(std::to_string(networkController.getToday()).c_str());
+  timeService.begin();
+  currentTimestamp = timeService.getUnixMillis();
 
   selectedSchedule = dataAccess.getSelectedSchedule();
+  scheduleSnapshot.publish(selectedSchedule);
   Serial.print("Selected Schedule: ");
   if (selectedSchedule != nullptr) {
     Serial.println(selectedSchedule->ID);
@@ -188,26 +288,53 @@ void setup() {
   //const long actualLastFedTimestamp = dataAccess.getLastFedTimestampBefore(currentTimestamp);
   lastFedTimestamp = getUnixTimestamp(currentTimestamp);
   //log missed feeds betwen actualLastFedTimestamp and lastFedTimestamp
-  numTimesFedToday = dataAccess.getNumFedFromTo(networkController.getToday(), networkController.getToday() + 1);
+  const long todayStart = getCalendarDay() * 86400L;
+  numTimesFedToday = dataAccess.getNumFedFromTo(todayStart, todayStart + 86400L);
+  compileSchedule();
+  //the feeds of the last 24 h at their real time, for the feeding day, the spacing and the rolling limit
+  std::vector<long> fedTimestamps;
+  dataAccess.getFedTimestampsFromTo(lastFedTimestamp - 86400L, lastFedTimestamp + 1, fedTimestamps);
+  for (long fedTimestamp : fedTimestamps) {
+    feedWindow.feedDone(fedTimestamp * 1000LL);
+  }
 
+  feedController.init(systemSettings->ContainerCloseLatency);
   machineController.initControls();
-  machineController.setContainerScaleCalibration(systemSettings->ContainerScale, systemSettings->ContainerOffset);
-  machineController.setPlateScaleCalibration(systemSettings->PlateScale, systemSettings->PlateOffset);
+  motorSupervisor.init();
+  machineController.setContainerScaleCalibration(systemSettings->ContainerScale, systemSettings->ContainerOffset, systemSettings->ContainerScaleQuadratic);
+  machineController.setPlateScaleCalibration(systemSettings->PlateScale, systemSettings->PlateOffset, systemSettings->PlateScaleQuadratic);
   networkController.initWebserver();
+  if (!networkController.startBroadcaster()) {
+    Serial.println("Couldnt start broadcaster!");
+    systemFault = true;
+  }
 
   previousTimestamp = currentTimestamp;
-  MachineStatus* status = new MachineStatus();
-  status->ContainerLoad = machineController.getContainerLoad();
-  status->PlateLoad = machineController.getPlateLoad();
+  machineController.sample();
+  const ScaleSample sample = machineController.getLatestSample();
+  lastSampleSequence = sample.Sequence;
+  MachineStatus* status = currentStatus;
+  status->ContainerLoad = sample.ContainerLoad;
+  status->PlateLoad = sample.PlateLoad;
   status->Open = false;
   status->MotorOperation = true;
   status->SDCardConnection = true;
   status->WiFiConnection = true;
   status->AutomaticFeeding = false;
   status->ManualFeeding = false;
-  previousStatus = status;
-
-  setLEDReady();
+  status->State = FeedIdle;
+  status->FeedTransitions = 0;
+  status->SampleRate = sample.SampleRate;
+  containerSlope.add(currentTimestamp, status->ContainerLoad);
+  plateSlope.add(currentTimestamp, status->PlateLoad);
+  status->ContainerFlowRate = 0;
+  status->PlateFlowRate = 0;
+  status->ContainerOpening = 0;
+  publishedStatus.write(*status);
+  machineController.startSampler(controlEvents, SAMPLE_EVENT);
+  powerManager.init();
+
+  updateStatusLED();
 }
 
 void printRam() {
@@ -233,67 +360,17 @@ void loop() {
   //printRam();
   //Serial.print("loop ");
   //Serial.println(millis());
-  currentTimestamp = networkController.getCurrentDaytime();
-  currentStatus = getUpdatedStatus();
-
-  if (feedPending()) {
-    if (!selectedSchedule->Active || currentStatus->ManualFeeding || (selectedSchedule->OnlyWhenEmpty && currentStatus->PlateLoad > PLATE_EMPTY_THRESHOLD) || currentStatus->ContainerLoad <= CONTAINER_EMPTY_THRESHOLD) {
-      //skip feed
-      lastFedTimestamp = getUnixTimestamp(currentTimestamp);
-      Event skippedFeed;
-      skippedFeed.CreatedOn = lastFedTimestamp;
-      skippedFeed.Type = SkippedFeed;
-      //dataAccess.logEventHistory(skippedFeed);
-      eventHistoryBuffer.push_back(skippedFeed);
-      //log
-    } else if (!currentStatus->Open) {
-      //start feeding
-      Serial.println("Start feeding!");
-      currentFeedTargetWeight = max(currentStatus->ContainerLoad - userSettings->PlateFilling, (double)0) + SAFETY_WEIGHT_GAP;
-      openContainer();
-      currentStatus->AutomaticFeeding = true;
-      Serial.print("Targetweight: ");
-      Serial.println(currentFeedTargetWeight);
-    } else if (currentStatus->ContainerLoad <= currentFeedTargetWeight || currentStatus->ContainerLoad <= CONTAINER_EMPTY_THRESHOLD) {
-      //finished feeding
-      Serial.println("Finished feeding");
-      lastFedTimestamp = getUnixTimestamp(currentTimestamp);
-      currentFeedTargetWeight = 0;
-      numTimesFedToday++;
-      if (selectedSchedule != nullptr && selectedSchedule->Mode == MaxTimes && numTimesFedToday == selectedSchedule->MaxTimes) {
-        //set wait timestamp tomorrow
-      }
-      closeContainer();
-      currentStatus->AutomaticFeeding = false;
-      Event feed;
-      feed.CreatedOn = lastFedTimestamp;
-      feed.Type = Feed;
-      //dataAccess.logEventHistory(feed);
-      eventHistoryBuffer.push_back(feed);
-      Serial.print("Final weight: ");
-      Serial.println(currentStatus->PlateLoad);
-    } else if (!currentStatus->MotorOperation) {
-      //abort feeding
-      Serial.println("Abort feeding because Motor fail");
-      lastFedTimestamp = getUnixTimestamp(currentTimestamp);
-      currentFeedTargetWeight = 0;
-      Serial.print("Current Feed Targetweight: ");
-      Serial.println(currentFeedTargetWeight);
-      closeContainer();
-      currentStatus->AutomaticFeeding = false;
-      Event motorFailure;
-      motorFailure.CreatedOn = lastFedTimestamp;
-      motorFailure.Type = MotorFaliure;
-      Event feedMissed;
-      feedMissed.CreatedOn = lastFedTimestamp;
-      feedMissed.Type = MissedFeed;
-      //dataAccess.logEventHistory(motorFailure);
-      //dataAccess.logEventHistory(feedMissed);
-      eventHistoryBuffer.push_back(motorFailure);
-      eventHistoryBuffer.push_back(feedMissed);
-      currentStatus->MotorOperation = true;
-    }
-  }
+  waitForWork();
+  currentTimestamp = timeService.getUnixMillis();
+  updateStatus();
+  handleCommands();
+  //old versions are freed here once the readers moved on
+  scheduleSnapshot.reclaim();
+  userSettingsSnapshot.reclaim();
+  scaleCalibration.update(machineController.getLatestSample(), currentTimestamp);
+
+  updateFeedState();
+  updateStatusLED();
   /*
   Serial.print("prevTime: ");
   Serial.println(previousTimestamp);
@@ -301,16 +378,124 @@ void loop() {
   Serial.println(currentTimestamp);
   */
   const SignificantWeightChange significantChange = weightDifferenceSignificant();
-  updateLoopFrequency(significantChange);
+  updateLoopFrequency();
+  updateSamplingPhase();
   handleCurrentData(significantChange);
   handleNotifications();
+  handleMotorEvents();
   previousTimestamp = currentTimestamp;
-  delete previousStatus;
-  previousStatus = currentStatus;
-  double delayVal = ((double)1 / CURRENT_LOOP_FREQ) * 1000;
-  //Serial.print("Delay Val: ");
-  //Serial.println(delayVal);
-  vTaskDelay(pdMS_TO_TICKS(delayVal));
+  publishedStatus.write(*currentStatus);
+#ifdef SOAK_TEST
+  reportSoakTest();
+#endif
+}
+
+//While idle the CPU runs slow and sleeps during the wait. Before a feed the loop wakes POWER_WAKE_LEAD early
+//to switch to full clock, so the feed itself starts without a sleep wakeup
+EventBits_t waitForWork() {
+  const long untilFeed = getTimeUntilNextFeed();
+  const bool feedTime = untilFeed >= 0;
+  const bool busy = loopGovernor.getTier() != IdleTier || feedController.getState() != FeedIdle;
+  const bool pwmOutputs = machineController.isServoAttached() || statusLED.isBlinking();
+  const bool performance = powerManager.update(busy, networkController.getWebClientCount() > 0, feedTime ? untilFeed : MAX_FEED_WAIT, pwmOutputs);
+
+  //within POWER_WAKE_LEAD the manager is at full clock, a wait cut at MAX_FEED_WAIT does not end at a feed
+  const bool feedWait = feedTime && untilFeed < MAX_FEED_WAIT && performance;
+  const long timeout = !feedTime ? MAX_IDLE_TIME : (performance ? untilFeed : untilFeed - POWER_WAKE_LEAD);
+  powerManager.beginWait(feedWait ? timeout : -1);
+  const EventBits_t events = xEventGroupWaitBits(controlEvents, CONTROL_EVENTS, pdTRUE, pdFALSE, pdMS_TO_TICKS(timeout));
+  powerManager.endWait((events & CONTROL_EVENTS) == 0);
+  return events;
+}
+
+//ms until the next feed time, at most MAX_FEED_WAIT, or -1 if the feeds do not depend on the time
+long getTimeUntilNextFeed() {
+  if (selectedSchedule == nullptr || feedPostponedSince > 0) {
+    //a postponed feed is checked with the next sample
+    return -1;
+  }
+
+  if (selectedSchedule->Mode == MaxTimes) {
+    //once eligible, the plate load decides, which is checked with every sample
+    const int64_t untilEligible = feedWindow.getNextEligible() - timeService.getUnixMillis();
+    return untilEligible > 0 ? (long)min(untilEligible, (int64_t)MAX_FEED_WAIT) : -1;
+  }
+
+  //ms after midnight of the loaded day, the table is reloaded when the day changes
+  int64_t next = feedTimeTable.getNextDaytime();
+  if (next < 0 && selectedSchedule->Mode == Calendar) {
+    next = calendarNextDayFire;
+  } else if (next < 0) {
+    const long first = feedTimeTable.getFirstDaytime();
+    next = first >= 0 ? MS_PER_DAY + first : -1;
+  }
+  if (next < 0) {
+    return -1;
+  }
+  return (long)max((int64_t)0, min(next - timeService.getDaytime(), (int64_t)MAX_FEED_WAIT));
+}
+
+void compileSchedule() {
+  if (selectedSchedule == nullptr || selectedSchedule->Mode == MaxTimes) {
+    feedTimeTable.clear();
+    if (selectedSchedule != nullptr) {
+      feedWindow.configure(selectedSchedule->MaxTimes, selectedSchedule->MaxTimesStartTime, selectedSchedule->MinFeedSpacing, selectedSchedule->RollingLimit);
+    }
+    return;
+  }
+
+  if (selectedSchedule->Mode == FixedDaytime) {
+    feedTimeTable.compile(selectedSchedule->Daytimes, getLastFedDaytime());
+    return;
+  }
+
+  if (!calendarSchedule.compile(selectedSchedule->Rules.c_str())) {
+    Serial.println("Invalid calendar rules, no feeds!");
+  }
+  loadCalendarDay(getLastFedDaytime());
+}
+
+//the feed time table of a calendar schedule holds the daytimes of the current day only
+void loadCalendarDay(long handledUntil) {
+  const long day = getCalendarDay();
+  std::vector<long> daytimes;
+  calendarSchedule.getDaytimes(day, daytimes);
+  feedTimeTable.compile(daytimes, handledUntil);
+
+  long fireDay;
+  long fireDaytime;
+  if (calendarSchedule.getNextFire(day, handledUntil, fireDay, fireDaytime)) {
+    Serial.print("Next calendar feed in days: ");
+    Serial.print(fireDay - day);
+    Serial.print(", at daytime (ms): ");
+    Serial.println(fireDaytime);
+  }
+
+  //once today is done, the loop sleeps until this fire instead of polling through feedless days
+  calendarNextDayFire = -1;
+  if (calendarSchedule.getNextFire(day, MS_PER_DAY, fireDay, fireDaytime)) {
+    calendarNextDayFire = (int64_t)(fireDay - day) * MS_PER_DAY + fireDaytime;
+  }
+}
+
+//days since 1970-01-01
+long getCalendarDay() {
+  return getDay(getUnixTimestamp(currentTimestamp));
+}
+
+//ms since midnight of the last handled feed, -1 if there was none today
+long getLastFedDaytime() {
+  if (getDay(lastFedTimestamp) != getCalendarDay()) {
+    return -1;
+  }
+  return getDaytime(lastFedTimestamp * 1000LL);
+}
+
+//a feed was done, skipped or aborted
+void markFeedHandled() {
+  lastFedTimestamp = getUnixTimestamp(currentTimestamp);
+  feedTimeTable.advance(getDaytime(currentTimestamp));
+  feedWindow.feedMissed(currentTimestamp);
 }
 
 ScaleData createScaleDataHistory(Scale scaleID, double value) {
@@ -322,57 +507,171 @@ ScaleData createScaleDataHistory(Scale scaleID, double value) {
 }
 
 void openContainer() {
-  Serial.println("Open Container!");
-  machineController.openContainer();
-  currentStatus->Open = true;
+  feedController.openContainer(*currentStatus);
+}
 
-  if (motorCloseCheckHandle != nullptr && eTaskGetState(motorCloseCheckHandle) != eDeleted) {
-    motorCloseCheckRunning = false;
+void closeContainer() {
+  feedController.closeContainer(*currentStatus, currentTimestamp);
+}
+
+//the status of the last loop becomes the previous one, the current one starts as a copy of it
+void updateStatus() {
+  std::swap(previousStatus, currentStatus);
+  *currentStatus = *previousStatus;
+  MachineStatus* status = currentStatus;
+  const ScaleSample sample = machineController.getLatestSample();
+  status->ContainerLoad = sample.ContainerLoad;
+  status->PlateLoad = sample.PlateLoad;
+  status->SampleRate = sample.SampleRate;
+  //the loop also wakes without a new sample, repeated values would flatten the slopes
+  if (sample.Sequence != lastSampleSequence) {
+    lastSampleSequence = sample.Sequence;
+    containerSlope.add(currentTimestamp, status->ContainerLoad);
+    plateSlope.add(currentTimestamp, status->PlateLoad);
   }
+  status->ContainerFlowRate = containerSlope.getSlope();
+  status->PlateFlowRate = plateSlope.getSlope();
+  status->ContainerOpening = machineController.getContainerOpening();
+  status->MotorOperation = motorSupervisor.getMotorOperation();
+  motorSupervisor.updateLoad(status->ContainerLoad, status->ContainerFlowRate);
+}
 
-  if (motorOpenCheckHandle == nullptr) {
-    motorCheckParams.ContainerLoad = currentStatus->ContainerLoad;
-    // motorCheckParams.Open = true;
-    motorOpenCheckRunning = true;
-    xTaskCreatePinnedToCore(motorOpenCheckTask, "MotorOpenCheck", 4069, NULL, 1, &motorOpenCheckHandle, 1);
+//snapshot of the status published by the last loop, safe to call from any task
+MachineStatus getStatusSnapshot() {
+  return publishedStatus.read();
+}
+
+void handleCommands() {
+  Command command;
+  while (commandQueue.pop(command)) {
+    CommandResult result = {};
+    result.ID = command.ID;
+    result.Type = command.Type;
+    result.Latency = micros() - command.EnqueuedAt;
+    result.Success = executeCommand(command, result.Value);
+    recordCommandLatency(command.Type, result.Latency);
+    networkController.publishCommandResult(result);
   }
 }
 
-void closeContainer() {
-  Serial.println("Close Container!");
-  machineController.closeContainer();
-  currentStatus->Open = false;
+bool executeCommand(const Command& command, int& value) {
+  //servo and scales belong to a running feed until its final weight is measured
+  const bool feeding = feedController.getState() != FeedIdle;
+
+  switch (command.Type) {
+    case ContainerCommand:
+      return !feeding && handleContainerCommand(command.Open);
+    case ScheduleCommand:
+      applySchedule(command.NewSchedule);
+      return true;
+    case UserSettingsCommand:
+      publishUserSettings(command.NewUserSettings);
+      return true;
+    case ContainerAngleCommand:
+      return !feeding && setContainerAngle(command.Open, command.Angle);
+    case TareCommand:
+      if (feeding) {
+        return false;
+      }
+      return command.ScaleID == Container ? machineController.tareContainerScale() : machineController.tarePlateScale();
+    case PlateTareCommand:
+      return !feeding && tarePlateScaleWithPlate();
+    case CalibrationCommand:
+      if (feeding || scaleCalibration.isActive()) {
+        return false;
+      }
+      //readings are collected by the loop, progress and result are sent via websocket
+      value = scaleCalibration.start(command.ScaleID, command.Weight, command.Points, command.Quadratic);
+      return value > 0;
+    case CalibrationPointCommand:
+      value = command.JobID;
+      return scaleCalibration.addPoint(command.JobID, command.Weight);
+    case CalibrationCancelCommand:
+      value = command.JobID;
+      return scaleCalibration.cancel(command.JobID);
+    case NUM_COMMAND_TYPES:
+      break;
+  }
+  return false;
+}
+
+void recordCommandLatency(CommandType type, unsigned long latency) {
+  CommandLatency& stats = commandMetrics.Latency[type];
+  stats.Count++;
+  stats.Last = latency;
+  stats.Max = max(stats.Max, latency);
+  stats.Mean += ((double)latency - stats.Mean) / stats.Count;
+  publishedCommandMetrics.write(commandMetrics);
+}
+
+bool handleContainerCommand(bool open) {
+  if (open) {
+    openContainer();
+    currentStatus->ManualFeeding = true;
+  } else {
+    closeContainer();
+    currentStatus->ManualFeeding = false;
+  }
+  return true;
+}
+
+bool setContainerAngle(bool open, int angle) {
+  Serial.print("Container angle ");
+  Serial.print(open ? "(Open)" : "(Closed)");
+  Serial.print(", New Angle: ");
+  Serial.println(angle);
 
-  if (motorOpenCheckHandle != nullptr && eTaskGetState(motorOpenCheckHandle) != eDeleted) {
-    motorOpenCheckRunning = false;
+  if (open) {
+    systemSettings->ContainerAngleOpen = angle;
+  } else {
+    systemSettings->ContainerAngleClose = angle;
   }
+  const bool success = dataAccess.updateSystemSettings(systemSettings);
 
-  if (motorCloseCheckHandle == nullptr) {
-    motorCheckParams.ContainerLoad = currentStatus->ContainerLoad;
-    // motorCheckParams.Open = false;
-    motorCloseCheckRunning = true;
-    xTaskCreatePinnedToCore(motorCloseCheckTask, "MotorCloseCheck", 4069, NULL, 1, &motorCloseCheckHandle, 1);
+  //move there to check the angle
+  if (open) {
+    motorSupervisor.open(false);
+  } else {
+    motorSupervisor.close(false);
   }
+  return success;
 }
 
-MachineStatus* getUpdatedStatus() {
-  MachineStatus* status = new MachineStatus();
-  *status = *previousStatus;
-  status->ContainerLoad = machineController.getContainerLoad();
-  status->PlateLoad = machineController.getPlateLoad();
-  return status;
+void publishUserSettings(UserSettings* newUserSettings) {
+  userSettings = newUserSettings;
+  userSettingsSnapshot.publish(newUserSettings);
+}
+
+//the published settings are never modified in place, the tare goes into a new version
+bool tarePlateScaleWithPlate() {
+  UserSettings* updated = new UserSettings(*userSettings);
+  //the latest sample is recent enough, no extra reading that would block the loop
+  updated->PlateTAR += machineController.getLatestSample().PlateLoad;
+  if (!dataAccess.updateUserSettings(updated)) {
+    delete updated;
+    return false;
+  }
+  publishUserSettings(updated);
+  return true;
+}
+
+void applySchedule(Schedule* newSchedule) {
+  selectedSchedule = newSchedule;
+  scheduleSnapshot.publish(newSchedule);
+  if (selectedSchedule != nullptr) {
+    //copied again by the background write
+    Schedule historySchedule = *selectedSchedule;
+    historySchedule.CreatedOn = getUnixTimestamp(currentTimestamp);
+    dataAccess.logScheduleHistory(&historySchedule);
+  }
+  compileSchedule();
 }
 
 SignificantWeightChange weightDifferenceSignificant() {
-  const double time_D = (double)(currentTimestamp - previousTimestamp) / 1000;
-  const double container_D = (currentStatus->ContainerLoad - previousStatus->ContainerLoad) / time_D;
-  const double plate_D = (currentStatus->PlateLoad - previousStatus->PlateLoad) / time_D;
+  //least squares slopes over the latest readings, independent of the loop period
+  const double container_D = currentStatus->ContainerFlowRate;
+  const double plate_D = currentStatus->PlateFlowRate;
   SignificantWeightChange significantChange = None;
-  /*
-  Serial.print("Container_D: ");
-  Serial.println(container_D);
-  Serial.print("plate_D: ");
-  Serial.println(plate_D);*/
 
   if (abs(container_D) > WEIGHT_D_THRESHOLD && abs(plate_D) > WEIGHT_D_THRESHOLD) {
     significantChange = Both;
@@ -385,52 +684,143 @@ SignificantWeightChange weightDifferenceSignificant() {
   return significantChange;
 }
 
-void updateLoopFrequency(SignificantWeightChange significantChange) {
-  /*Serial.print("NoStatusChange: ");
-  Serial.println(noStatusChangeTimestamp);
-  Serial.print("currentTimestamp: ");
-  Serial.println(currentTimestamp);*/
+//the container and calibration need every reading, the final portion weight a steady one
+void updateLoopFrequency() {
+  LoopTier minTier = IdleTier;
+  if (currentStatus->Open || currentStatus->AutomaticFeeding || scaleCalibration.isActive()) {
+    minTier = FastTier;
+  } else if (machineController.getSamplingPhase() == MeasuringPhase) {
+    minTier = ActiveTier;
+  }
+
+  const double change = max(abs(currentStatus->ContainerFlowRate), abs(currentStatus->PlateFlowRate));
+  loopGovernor.update(currentTimestamp, change, minTier);
+  CURRENT_LOOP_FREQ = loopGovernor.getFrequency();
+  machineController.setSampleInterval(1000 / CURRENT_LOOP_FREQ);
+}
+
+//duty cycle and estimated power, safe to call from any task
+PowerStats getPowerStats() {
+  return powerManager.getStats();
+}
+
+//time per loop rate tier, safe to call from any task
+LoopGovernorStats getLoopGovernorStats() {
+  return loopGovernor.getStats();
+}
+
+void updateSamplingPhase() {
+  feedController.updateMeasurement(*currentStatus, currentTimestamp);
+}
 
-  if (CURRENT_LOOP_FREQ == LOOP_FREQ_FAST && currentTimestamp - noStatusChangeTimestamp > COOLDOWN_TIME * 1000) {
-    //Serial.println("Loop freq normal");
-    CURRENT_LOOP_FREQ = LOOP_FREQ_NORMAL;
+//Starts a due feed, the FeedController runs it from there. Skipped feeds are handled here
+void handleFeedIdle() {
+  if (!feedPending()) {
+    feedPostponedSince = 0;
+    return;
   }
 
-  if (significantChange != None || currentStatus->Open) {
-    CURRENT_LOOP_FREQ = LOOP_FREQ_FAST;
-    // Serial.println("Loop freq fast");
+  //the food would spoil the calibration readings, the feed waits until the calibration is done
+  const bool calibrating = scaleCalibration.isActive();
+  if (calibrating) {
+    if (feedPostponedSince == 0) {
+      Serial.println("Feed postponed by calibration");
+      feedPostponedSince = currentTimestamp;
+    }
+    if (currentTimestamp - feedPostponedSince < FEED_MAX_POSTPONE) {
+      return;
+    }
+  }
+  feedPostponedSince = 0;
+
+  if (calibrating || !selectedSchedule->Active || currentStatus->ManualFeeding || (selectedSchedule->OnlyWhenEmpty && currentStatus->PlateLoad > PLATE_EMPTY_THRESHOLD) || currentStatus->ContainerLoad <= CONTAINER_EMPTY_THRESHOLD) {
+    //skip feed
+    markFeedHandled();
+    Event skippedFeed;
+    skippedFeed.CreatedOn = lastFedTimestamp;
+    skippedFeed.Type = SkippedFeed;
+    //dataAccess.logEventHistory(skippedFeed);
+    networkController.publishEvent(skippedFeed);
+    return;
   }
 
-  if (significantChange != None) {
-    noStatusChangeTimestamp = currentTimestamp;
+  Serial.println("Start feeding!");
+  const double targetWeight = max(currentStatus->ContainerLoad - userSettings->PlateFilling, (double)0);
+  feedController.start(*currentStatus, currentTimestamp, targetWeight, (DispenseStrategy)selectedSchedule->DispenseMode);
+  Serial.print("Targetweight: ");
+  Serial.println(targetWeight);
+}
+
+void updateFeedState() {
+  if (feedController.getState() == FeedIdle) {
+    handleFeedIdle();
+  } else {
+    feedController.update(*currentStatus, currentTimestamp, 1 / CURRENT_LOOP_FREQ);
   }
+
+  const FeedState current = feedController.getState();
+  currentStatus->State = current;
+  currentStatus->FeedTransitions = feedController.getTransitionCount();
+  currentStatus->AutomaticFeeding = current == FeedOpening || current == FeedDispensing || current == FeedClosing;
+}
+
+//transitions of the feed state machine, safe to call from any task
+FeedTrace getFeedTrace() {
+  return feedController.getTrace();
+}
+
+void onFeedFinished() {
+  markFeedHandled();
+  numTimesFedToday++;
+  //computes when the next MaxTimes feed is allowed
+  feedWindow.feedDone(currentTimestamp);
+  motorFault = false;
+  Event feed;
+  feed.CreatedOn = lastFedTimestamp;
+  feed.Type = Feed;
+  //the feed window and the daily count are restored from these events after a restart
+  dataAccess.logEventHistory(feed);
+  networkController.publishEvent(feed);
+  Serial.print("Final weight: ");
+  Serial.println(currentStatus->PlateLoad);
+}
+
+void onFeedAborted() {
+  markFeedHandled();
+  Event feedMissed;
+  feedMissed.CreatedOn = lastFedTimestamp;
+  feedMissed.Type = MissedFeed;
+  //dataAccess.logEventHistory(feedMissed);
+  networkController.publishEvent(feedMissed);
+}
+
+//the fault is shown until the next finished feed
+void onMotorFailure() {
+  Event motorFailure;
+  motorFailure.CreatedOn = getUnixTimestamp(currentTimestamp);
+  motorFailure.Type = MotorFaliure;
+  //dataAccess.logEventHistory(motorFailure);
+  networkController.publishEvent(motorFailure);
+  motorFault = true;
+}
+
+void onFeedResult(const FeedResult& result) {
+  dataAccess.logFeedHistory(result);
+  systemSettings->ContainerCloseLatency = result.CloseLatency;
+  dataAccess.updateSystemSettingsAsync(*systemSettings);
 }
 
+//hands the status to the broadcaster task, serializing and sending happens on the network core
 void handleCurrentData(SignificantWeightChange significantChange) {
-  const bool clientsAvailable = networkController.hasWebClients();
-
-  ArduinoJson::DynamicJsonDocument doc(1024);
-  ArduinoJson::JsonObject status = doc.createNestedObject("status");
-  setJsonStatus(currentStatus, status);
-  ArduinoJson::JsonObject history = doc.createNestedObject("history");
-  ArduinoJson::JsonArray schedules = history.createNestedArray("schedules");
-  ArduinoJson::JsonArray events = history.createNestedArray("events");
-  ArduinoJson::JsonArray scaleData = history.createNestedArray("scaleData");
-  /*
-  if (historySchedule != nullptr) {
-    ArduinoJson::JsonObject dataObject = schedules.createNestedObject();
-    setJsonSchedule(dataObject, historySchedule);
-    delete historySchedule;
-    historySchedule = nullptr;
-  }*/
-
-  if (!eventHistoryBuffer.empty()) {
-    for (Event eventData : eventHistoryBuffer) {
-      ArduinoJson::JsonObject dataObject = events.createNestedObject();
-      dataObject["CreatedOn"] = eventData.CreatedOn;
-      dataObject["Type"] = eventData.Type;
-    }
-    eventHistoryBuffer.clear();
+  StatusMessage message;
+  message.Status = *currentStatus;
+  message.HasCalibration = scaleCalibration.hasChanged();
+  if (message.HasCalibration) {
+    message.Calibration = scaleCalibration.getJob();
+  }
+  //a dropped message leaves the change for the next one, the final job state must reach the clients
+  if (networkController.publishStatus(message) && message.HasCalibration) {
+    scaleCalibration.clearChanged();
   }
   /*
   switch (significantChange) {
@@ -464,18 +854,10 @@ void handleCurrentData(SignificantWeightChange significantChange) {
       }
   }
   */
-  if (clientsAvailable) {
-    String serialized;
-    serializeJson(doc, serialized);
-    networkController.broadcast(serialized.c_str());
-    //Serial.print("Status doc overflowed: ");
-    //Serial.println(doc.overflowed());
-  }
-  doc.clear();
 
   //save and clear history buffers if possible/necessary
   /*Serial.println(millis());
-  if (CURRENT_LOOP_FREQ == LOOP_FREQ_NORMAL) {
+  if (loopGovernor.getTier() == IdleTier) {
     if (!containerScaleHistoryBuffer.empty()) {
       //log
       Serial.println("Empty + log Container Scale buffer");
@@ -511,17 +893,42 @@ void handleNotifications() {
       && previousStatus->ContainerLoad > CONTAINER_EMPTY_THRESHOLD
       && currentStatus->ContainerLoad <= CONTAINER_EMPTY_THRESHOLD
       && currentStatus->ContainerLoad > NO_CONTAINER_THRESHOLD) {
-    //Task -> check if condition still true later, if yes send notification
+    timerService.schedule(containerEmptyTimer, CONTAINER_EMPTY_CONFIRM_TIME);  //ignored without the timer
+  }
+
+  if (containerEmptyCheckDue.exchange(false)
+      && currentStatus->ContainerLoad <= CONTAINER_EMPTY_THRESHOLD
+      && currentStatus->ContainerLoad > NO_CONTAINER_THRESHOLD) {
+    Event containerEmpty;
+    containerEmpty.CreatedOn = getUnixTimestamp(currentTimestamp);
+    containerEmpty.Type = ContainerEmpty;
+    networkController.publishEvent(containerEmpty);
+    dataAccess.logEventHistory(containerEmpty);
   }
 
   if (dayChanged()) {
     numTimesFedToday = 0;
+    if (selectedSchedule != nullptr && selectedSchedule->Mode == Calendar) {
+      loadCalendarDay(-1);
+    } else {
+      feedTimeTable.newDay();
+    }
     if (userSettings->Notifications.DidNotEatInADay.Active) {
       //send notification
     }
   }
 }
 
+void handleMotorEvents() {
+  const int jamCount = motorSupervisor.getJamCount();
+  for (; handledJamCount < jamCount; handledJamCount++) {
+    Event jam;
+    jam.CreatedOn = getUnixTimestamp(currentTimestamp);
+    jam.Type = ContainerJam;
+    networkController.publishEvent(jam);
+  }
+}
+
 bool feedPending() {
   if (selectedSchedule == nullptr) {
     return false;
@@ -529,41 +936,29 @@ bool feedPending() {
 
   bool pending = false;
 
-  if (selectedSchedule->Mode == FixedDaytime) {
-    long latestFeedtimeSmallerNow = -1;
-    //order daytimes descending
-    std::sort(selectedSchedule->Daytimes.begin(), selectedSchedule->Daytimes.end(), [](int a, int b) {
-      return a > b;
-    });
-    for (long datetime : selectedSchedule->Daytimes) {
-      if (datetime <= currentTimestamp) {
-        latestFeedtimeSmallerNow = datetime;
-        break;
-      }
-    }
-    /*Serial.print("CurrentTimestamp: ");
-    Serial.println(currentTimestamp);
-    Serial.print("LatestFeedtimeSmallerNow: ");
-    Serial.println(latestFeedtimeSmallerNow);
-    Serial.print("LastFed: ");
-    Serial.println(lastFedTimestamp);*/
-    pending = latestFeedtimeSmallerNow != -1 && getUnixTimestamp(latestFeedtimeSmallerNow) > lastFedTimestamp;
+  if (selectedSchedule->Mode == FixedDaytime || selectedSchedule->Mode == Calendar) {
+    pending = feedTimeTable.isDue(getDaytime(currentTimestamp));
   } else if (selectedSchedule->Mode == MaxTimes) {
-    pending = currentStatus->PlateLoad <= PLATE_EMPTY_THRESHOLD && numTimesFedToday < selectedSchedule->MaxTimes;
+    pending = feedWindow.isEligible(currentTimestamp) && currentStatus->PlateLoad <= PLATE_EMPTY_THRESHOLD;
   }
 
   return pending;
 }
 
 bool dayChanged() {
-  //TODO
-  return getDay(currentTimestamp / 1000) > getDay(previousTimestamp / 1000);
+  return currentTimestamp / MS_PER_DAY != previousTimestamp / MS_PER_DAY;
 }
 
 long getDay(long timestamp) {
   return timestamp / 86400L;
 }
 
-long getUnixTimestamp(long daytimeMS) {
-  return networkController.getToday() + daytimeMS / 1000;
+//ms since midnight
+long getDaytime(int64_t timestampMS) {
+  return timestampMS % MS_PER_DAY;
+}
+
+//unix in s
+long getUnixTimestamp(int64_t timestampMS) {
+  return timestampMS / 1000;
 }
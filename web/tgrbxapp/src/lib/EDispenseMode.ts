@@ -0,0 +1,4 @@
+export enum EDispenseMode {
+  Continuous,
+  Pulse,
+}
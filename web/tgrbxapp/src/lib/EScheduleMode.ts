@@ -1,4 +1,5 @@
 export enum EScheduleMode {
   FixedDaytime,
   MaxTimes,
+  Calendar,
 }
@@ -0,0 +1,19 @@
+export interface CommandResult {
+  ID: number;
+  Type: CommandType;
+  Success: boolean;
+  Value: number;
+  Latency: number;
+}
+
+export enum CommandType {
+  Container,
+  Schedule,
+  UserSettings,
+  ContainerAngle,
+  Tare,
+  PlateTare,
+  Calibration,
+  CalibrationPoint,
+  CalibrationCancel,
+}
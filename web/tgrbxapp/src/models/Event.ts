@@ -15,4 +15,5 @@ export enum EventType {
   SDConnectionLost,
   SDConnectionReturned,
   SkippedFeed,
+  ContainerJam,
 }
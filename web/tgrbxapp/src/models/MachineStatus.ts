@@ -6,4 +6,19 @@ export interface MachineStatus {
   SDCardConnection: boolean;
   AutomaticFeeding: boolean;
   ManualFeeding: boolean;
+  SampleRate?: number;
+  ContainerFlowRate?: number;
+  PlateFlowRate?: number;
+  ContainerOpening?: number;
+  FeedState?: FeedState;
+  FeedTransitions?: number;
+}
+
+export enum FeedState {
+  Idle,
+  Opening,
+  Dispensing,
+  Closing,
+  Settling,
+  Aborted,
 }
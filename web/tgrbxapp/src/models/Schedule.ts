@@ -1,3 +1,4 @@
+import { EDispenseMode } from 'src/lib/EDispenseMode';
 import { EScheduleMode } from 'src/lib/EScheduleMode';
 
 export interface Schedule {
@@ -10,5 +11,9 @@ export interface Schedule {
   Daytimes?: number[];
   MaxTimes?: number;
   MaxTimesStartTime?: number;
+  MinFeedSpacing?: number;
+  RollingLimit?: number;
   OnlyWhenEmpty?: boolean;
+  DispenseMode?: EDispenseMode;
+  Rules?: string;
 }
@@ -1,3 +1,4 @@
+import { CommandResult } from './CommandResult';
 import { EventData } from './Event';
 import { MachineStatus } from './MachineStatus';
 import { ScaleData } from './ScaleData';
@@ -6,6 +7,7 @@ import { Schedule } from './Schedule';
 export interface WebSocketData {
   history: HistoryData;
   status: MachineStatus;
+  commands?: CommandResult[];
 }
 
 export interface HistoryData {